@@ -0,0 +1,707 @@
+// native benchmarks, see bench.sh
+#include <stdio.h>
+
+#include "main.cpp"
+#include "platform_native.h"
+
+static u32 bench_seed = 1;
+static float bench_random() {
+  bench_seed = bench_seed * 1664525u + 1013904223u;
+  return (bench_seed >> 8) / float(1 << 24);
+}
+
+static Vec3 bench_random_dir() {
+  return v3_normalize({bench_random() - 0.5f, bench_random() - 0.5f, bench_random() - 0.5f});
+}
+
+/* bvh: query cost vs object count, against a linear scan over the same boxes */
+static void bench_bvh() {
+  printf("%-10s %12s %12s %12s %12s %12s\n",
+         "objects", "insert ns", "churn ns", "ray ns", "linear ns", "box ns");
+
+  for (u32 count = 1000; count <= 1000000; count *= 10) {
+    Box *boxes = new Box[count];
+    u32 *leaves = new u32[count];
+    Bvh bvh;
+    bvh_init(&bvh);
+
+    // keep the density roughly constant, ~1 object per 8 cubic units
+    float side = 2.0f * __builtin_cbrtf(float(count));
+    for (u32 i = 0; i < count; ++i) {
+      Vec3 pos = {bench_random() * side, bench_random() * side, bench_random() * side};
+      boxes[i] = expand_box_from_point(pos, 0.25f + bench_random() * 0.5f);
+    }
+
+    double start = native_now();
+    for (u32 i = 0; i < count; ++i) {
+      leaves[i] = bvh_insert(&bvh, boxes[i], i);
+    }
+    double insert_ns = (native_now() - start) / count * 1e9;
+
+    const u32 churn = 10000;
+    start = native_now();
+    for (u32 i = 0; i < churn; ++i) {
+      u32 item = u32(bench_random() * count);
+      bvh_remove(&bvh, leaves[item]);
+      leaves[item] = bvh_insert(&bvh, boxes[item], item);
+    }
+    double churn_ns = (native_now() - start) / churn * 1e9;
+
+    const u32 rays = 10000;
+    u32 hits = 0;
+    start = native_now();
+    for (u32 i = 0; i < rays; ++i) {
+      Ray ray = {{bench_random() * side, bench_random() * side, bench_random() * side}, bench_random_dir()};
+      Vec3 inv_dir = {1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z};
+      // closest hit, like picking does
+      bvh_raycast(&bvh, ray, PICK_REACH, [&](u32 item, float max_t) {
+        float t = ray_vs_aabb(ray.origin, inv_dir, boxes[item], max_t);
+        if (t < max_t) {
+          hits++;
+          return t;
+        }
+        return max_t;
+      });
+    }
+    double ray_ns = (native_now() - start) / rays * 1e9;
+
+    const u32 linear_rays = 100;
+    start = native_now();
+    for (u32 i = 0; i < linear_rays; ++i) {
+      Ray ray = {{bench_random() * side, bench_random() * side, bench_random() * side}, bench_random_dir()};
+      Vec3 inv_dir = {1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z};
+      for (u32 j = 0; j < count; ++j) {
+        if (ray_vs_aabb(ray.origin, inv_dir, boxes[j], PICK_REACH) != MATH_INF) {
+          hits++;
+        }
+      }
+    }
+    double linear_ns = (native_now() - start) / linear_rays * 1e9;
+
+    const u32 queries = 10000;
+    start = native_now();
+    for (u32 i = 0; i < queries; ++i) {
+      Vec3 pos = {bench_random() * side, bench_random() * side, bench_random() * side};
+      bvh_query_box(&bvh, expand_box_from_point(pos, 1.0f), [&](u32) { hits++; });
+    }
+    double box_ns = (native_now() - start) / queries * 1e9;
+
+    printf("%-10u %12.1f %12.1f %12.1f %12.1f %12.1f\n",
+           count, insert_ns, churn_ns, ray_ns, linear_ns, box_ns);
+
+    // keeps the queries from being optimized out
+    if (hits == 0) {
+      printf("no hits?\n");
+    }
+
+    mem_free(bvh.nodes, bvh.capacity * sizeof(BvhNode));
+    delete[] boxes;
+    delete[] leaves;
+  }
+}
+
+/* soa: brute force radius scans, the old array of Objects against the split position arrays */
+static void bench_soa() {
+  printf("%-10s %14s %14s\n", "objects", "aos radius ns", "soa radius ns");
+
+  for (u32 count = 1000; count <= 1000000; count *= 10) {
+    World world = {};
+    world_init(&world);
+    Object *objects = new Object[count];
+    u32 *found = new u32[count];
+
+    float side = 2.0f * __builtin_cbrtf(float(count));
+    for (u32 i = 0; i < count; ++i) {
+      Object obj = default_obj(Shape_Cube);
+      obj.pos = {bench_random() * side, bench_random() * side, bench_random() * side};
+      objects[i] = obj;
+      place_world_obj(&world, obj);
+    }
+
+    // enough passes that the small worlds don't just measure the clock
+    u32 queries = 10000000 / count;
+    u32 hits = 0;
+
+    double start = native_now();
+    for (u32 q = 0; q < queries; ++q) {
+      Vec3 center = {bench_random() * side, bench_random() * side, bench_random() * side};
+      for (u32 i = 0; i < count; ++i) {
+        Vec3 d = objects[i].pos - center;
+        if (v3_dot(d, d) < 4.0f * 4.0f) {
+          found[hits++ % count] = i;
+        }
+      }
+    }
+    double aos_radius_ns = (native_now() - start) / queries * 1e9;
+
+    start = native_now();
+    for (u32 q = 0; q < queries; ++q) {
+      Vec3 center = {bench_random() * side, bench_random() * side, bench_random() * side};
+      hits += world_query_radius(&world, 0, world.object_count, center, 4.0f, found, count);
+    }
+    double soa_radius_ns = (native_now() - start) / queries * 1e9;
+
+
+    printf("%-10u %14.1f %14.1f\n", count, aos_radius_ns, soa_radius_ns);
+
+    if (hits == 0) {
+      printf("no hits?\n");
+    }
+
+    world_free(&world);
+    delete[] objects;
+    delete[] found;
+  }
+}
+
+#define BENCH_SAVE_PATH "bench.save"
+
+// a side x side square of chunks with `per_chunk` random objects each, written as a snapshot and opened
+static bool bench_save_world(i32 side, u32 per_chunk) {
+  u32 chunk_count = side * side;
+  SaveChunk *chunks = new SaveChunk[chunk_count];
+  SaveObject *objects = new SaveObject[chunk_count * per_chunk];
+
+  u32 count = 0;
+  for (i32 cx = 0; cx < side; ++cx) {
+    for (i32 cz = 0; cz < side; ++cz) {
+      chunks[cx * side + cz] = {cx, cz, count, per_chunk};
+      for (u32 i = 0; i < per_chunk; ++i) {
+        Object obj = default_obj(bench_random() < 0.5f ? Shape_Cube : Shape_Cylinder);
+        obj.pos = {(cx + bench_random()) * CHUNK_SIZE, bench_random() * 8.0f, (cz + bench_random()) * CHUNK_SIZE};
+        objects[count++] = save_object(obj);
+      }
+    }
+  }
+
+  bool ok = native_save_write_snapshot(BENCH_SAVE_PATH, {}, chunks, chunk_count, objects, count) &&
+            native_save_open(BENCH_SAVE_PATH);
+  delete[] chunks;
+  delete[] objects;
+  return ok;
+}
+
+/* stream: flying in a straight line over a big saved world, cost of stream_chunks and the rebake it causes per frame */
+static void bench_stream() {
+  printf("%-10s %10s %12s %12s %12s\n",
+         "objects", "resident", "mean us", "max us", "loaded MB");
+
+  for (u32 count = 10000; count <= 1000000; count *= 10) {
+    // ~20 objects per chunk column
+    i32 side = i32(__builtin_sqrtf(count / 20.0f));
+    u32 per_chunk = count / u32(side * side);
+    if (!bench_save_world(side, per_chunk)) {
+      return;
+    }
+    state_load(state);
+    World *world = &state->world;
+
+    // fly across it diagonally
+    native_counters.chunk_bytes_loaded = 0;
+    const int frames = 4000;
+    double total = 0, worst = 0;
+    for (int i = 0; i < frames; ++i) {
+      float t = side * CHUNK_SIZE * (1.0f - float(i) / frames);
+      double start = native_now();
+      stream_chunks(&state->chunks, world, {t, 2, t});
+      bake_mesh_regions(world);
+      double took = native_now() - start;
+      total += took;
+      worst = took > worst ? took : worst;
+    }
+
+    printf("%-10u %10u %12.1f %12.1f %12.2f\n",
+           per_chunk * side * side, u32(world->object_count), total / frames * 1e6, worst * 1e6,
+           native_counters.chunk_bytes_loaded / 1e6);
+  }
+  native_save_close();
+}
+
+/* save: opening a saved world and reading all of it in place, then the cost of autosaving edits on top
+ * and of baking them into a new snapshot */
+static void bench_save() {
+  printf("%-10s %10s %10s %10s %12s %12s %12s %12s\n",
+         "objects", "file MB", "open ms", "read ms", "resident ms", "autosave us", "reopen ms", "compact ms");
+
+  for (u32 count = 10000; count <= 1000000; count *= 10) {
+    i32 side = i32(__builtin_sqrtf(count / 16.0f));
+    u32 per_chunk = count / u32(side * side);
+    if (!bench_save_world(side, per_chunk)) {
+      return;
+    }
+    native_save_close();
+
+    double start = native_now();
+    native_save_open(BENCH_SAVE_PATH);
+    double open_ms = (native_now() - start) * 1e3;
+
+    // every chunk through the index, every object touched where it lies in the mapping
+    start = native_now();
+    float sum = 0;
+    u32 seen = 0;
+    for (i32 cx = 0; cx < side; ++cx) {
+      for (i32 cz = 0; cz < side; ++cz) {
+        const SaveChunk *chunk = native_save_find(cx, cz);
+        for (u32 i = 0; chunk != nullptr && i < chunk->count; ++i) {
+          sum += native_save.objects[chunk->first + i].pos[1];
+          seen++;
+        }
+      }
+    }
+    double read_ms = (native_now() - start) * 1e3;
+
+    // what the game does at startup: header and log, then the chunks around the camera
+    start = native_now();
+    state_load(state);
+    Vec3 center = {side * CHUNK_SIZE * 0.5f, 2, side * CHUNK_SIZE * 0.5f};
+    for (int i = 0; i < 16; ++i) {
+      stream_chunks(&state->chunks, &state->world, center);
+    }
+    double resident_ms = (native_now() - start) * 1e3;
+
+    // a few hundred edits, flushed like autosave does
+    const int edits = 200;
+    for (int i = 0; i < edits; ++i) {
+      Object obj = default_obj(Shape_Cube);
+      obj.pos = center + Vec3{bench_random() * 16.0f, 0, bench_random() * 16.0f};
+      edit_place_obj(&state->save, &state->world, obj);
+    }
+    u32 expected = state->world.object_count;
+    native_counters.save_bytes_appended = 0;
+    start = native_now();
+    save_flush(&state->save, &state->inventory);
+    double autosave_us = (native_now() - start) * 1e6;
+
+    // the edits come back from the log after a restart
+    start = native_now();
+    native_save_open(BENCH_SAVE_PATH);
+    state_load(state);
+    for (int i = 0; i < 16; ++i) {
+      stream_chunks(&state->chunks, &state->world, center);
+    }
+    double reopen_ms = (native_now() - start) * 1e3;
+    bool survived = state->world.object_count == expected;
+
+    // the same world again once they're in the snapshot, with nothing left in the log
+    start = native_now();
+    save_compact();
+    double compact_ms = (native_now() - start) * 1e3;
+    state_load(state);
+    for (int i = 0; i < 16; ++i) {
+      stream_chunks(&state->chunks, &state->world, center);
+    }
+
+    printf("%-10u %10.2f %10.3f %10.3f %12.3f %12.1f %12.3f %12.3f\n",
+           seen, native_save.map_size / 1e6, open_ms, read_ms, resident_ms, autosave_us, reopen_ms, compact_ms);
+    if (seen != per_chunk * side * side || sum == 0) {
+      printf("missed objects?\n");
+    }
+    if (!survived || native_counters.save_bytes_appended != edits * sizeof(SaveEdit)) {
+      printf("edits didn't survive: %u objects, expected %u\n", u32(state->world.object_count), expected);
+    }
+    if (state->world.object_count != expected || state->save.count != 0 || native_save.log_start != native_save.map_size) {
+      printf("compacting lost edits: %u objects, expected %u\n", u32(state->world.object_count), expected);
+    }
+    native_save_close();
+  }
+}
+
+/* frame: synthetic worlds of growing size, timing frame() and its stages one by one. every layout stays
+ * inside the chunks loaded around the camera, so all of it is in the world. also written to frame.json */
+enum Layout {
+  Layout_Grid,   // stacked layers of cubes on a lattice
+  Layout_Forest, // trunks with leaves on top, scattered
+  Layout_Base,   // walls and floors of a tall building, the camera inside it
+  Layout_COUNT,
+};
+
+const char *layout_names[] = {"grid", "forest", "base"};
+
+#define BENCH_FRAME_CENTER 16.0f // middle of chunk 0, 0
+#define BENCH_FRAME_HALF 80.0f   // out to the edge of the loaded chunks around it
+
+// fills `objects` with `count` objects laid out around the camera, returns where the camera goes
+static Vec3 bench_layout(Layout layout, SaveObject *objects, u32 count) {
+  float min = BENCH_FRAME_CENTER - BENCH_FRAME_HALF;
+  switch (layout) {
+    case Layout_Grid: {
+      u32 side = u32(__builtin_ceilf(__builtin_sqrtf(float(count))));
+      side = side > 2 * BENCH_FRAME_HALF ? u32(2 * BENCH_FRAME_HALF) : side;
+      float spacing = 2 * BENCH_FRAME_HALF / side;
+      for (u32 i = 0; i < count; ++i) {
+        Object obj = default_obj(Shape_Cube);
+        obj.pos = {min + (i % side + 0.5f) * spacing, (i / (side * side)) + 0.5f, min + ((i / side) % side + 0.5f) * spacing};
+        objects[i] = save_object(obj);
+      }
+      u32 layers = (count + side * side - 1) / (side * side);
+      return {BENCH_FRAME_CENTER, layers + 2.0f, BENCH_FRAME_CENTER};
+    }
+    case Layout_Forest: {
+      for (u32 i = 0; i + 1 < count; i += 2) {
+        Vec3 at = {min + bench_random() * 2 * BENCH_FRAME_HALF, 0, min + bench_random() * 2 * BENCH_FRAME_HALF};
+        Object trunk = default_obj(Shape_Cube);
+        trunk.drop = Item_Wood;
+        trunk.scale = {0.2, 4.0, 0.2};
+        trunk.pos = at + Vec3{0, 2, 0};
+        Object leaves = default_obj(Shape_Cylinder);
+        leaves.drop = Item_Leaves;
+        leaves.scale = {1.0, 2.0, 1.0};
+        leaves.pos = at + Vec3{0, 3, 0};
+        objects[i] = save_object(trunk);
+        objects[i + 1] = save_object(leaves);
+      }
+      if (count % 2) {
+        objects[count - 1] = save_object(default_obj(Shape_Cube));
+      }
+      return {BENCH_FRAME_CENTER, 2, BENCH_FRAME_CENTER};
+    }
+    case Layout_Base: {
+      // 48 x 48, rooms of 8 x 8, a floor every 4 layers
+      u32 i = 0;
+      for (i32 y = 0; i < count; ++y) {
+        for (i32 x = 0; x < 48 && i < count; ++x) {
+          for (i32 z = 0; z < 48 && i < count; ++z) {
+            if (y % 4 == 0 || x % 8 == 0 || z % 8 == 0) {
+              Object obj = default_obj(Shape_Cube);
+              obj.pos = {BENCH_FRAME_CENTER - 24 + x + 0.5f, y + 0.5f, BENCH_FRAME_CENTER - 24 + z + 0.5f};
+              objects[i++] = save_object(obj);
+            }
+          }
+        }
+      }
+      return {BENCH_FRAME_CENTER + 4, 2, BENCH_FRAME_CENTER + 4};
+    }
+    default:
+      return {};
+  }
+}
+
+// sorts `objects` into chunks and writes them out as a snapshot
+static bool bench_save_objects(SaveObject *objects, u32 count) {
+  i32 first = chunk_coord(BENCH_FRAME_CENTER - BENCH_FRAME_HALF);
+  i32 side = chunk_coord(BENCH_FRAME_CENTER + BENCH_FRAME_HALF - 0.001f) - first + 1;
+  SaveChunk *chunks = new SaveChunk[side * side]();
+  SaveObject *sorted = new SaveObject[count];
+  u32 *chunk_of = new u32[count];
+
+  for (u32 i = 0; i < count; ++i) {
+    chunk_of[i] = (chunk_coord(objects[i].pos[0]) - first) * side + (chunk_coord(objects[i].pos[2]) - first);
+    chunks[chunk_of[i]].count++;
+  }
+  u32 at = 0;
+  for (i32 x = 0; x < side; ++x) {
+    for (i32 z = 0; z < side; ++z) {
+      SaveChunk *chunk = &chunks[x * side + z];
+      *chunk = {first + x, first + z, at, chunk->count};
+      at += chunk->count;
+      chunk->count = 0;
+    }
+  }
+  for (u32 i = 0; i < count; ++i) {
+    SaveChunk *chunk = &chunks[chunk_of[i]];
+    sorted[chunk->first + chunk->count++] = objects[i];
+  }
+
+  bool ok = native_save_write_snapshot(BENCH_SAVE_PATH, {}, chunks, side * side, sorted, count) &&
+            native_save_open(BENCH_SAVE_PATH);
+  delete[] chunks;
+  delete[] sorted;
+  delete[] chunk_of;
+  return ok;
+}
+
+static void bench_frame() {
+  FILE *json = fopen("frame.json", "w");
+  if (json == nullptr) {
+    printf("can't write frame.json\n");
+    return;
+  }
+  fprintf(json, "{\"bench\": \"frame\", \"results\": [");
+
+  printf("%-8s %10s %10s %10s %10s %10s %12s %10s %12s\n", "layout", "objects", "resident",
+         "frame us", "pick us", "gizmo us", "rebake us", "submit us", "overlay us");
+
+  const float dt = 1.0f / 60.0f;
+  bool first_result = true;
+  for (int layout = 0; layout < Layout_COUNT; ++layout) {
+    for (u32 count = 100; count <= 1000000; count *= 10) {
+      SaveObject *objects = new SaveObject[count];
+      Vec3 camera = bench_layout(Layout(layout), objects, count);
+      bool ok = bench_save_objects(objects, count);
+      delete[] objects;
+      if (!ok) {
+        return;
+      }
+
+      state_load(state);
+      resize(1280, 720);
+      state->cam.position = state->sim.prev = state->sim.now = camera;
+      cam_set_rotation(&state->cam, {0.4f, 0, 0});
+      // wood in hand, so the gizmo looks for somewhere to put it
+      state->inventory = {};
+      state->inventory.items[0] = {Item_Wood, 1};
+      for (int i = 0; i < 30; ++i) {
+        frame(dt);
+      }
+
+      const int frames = 30;
+      double frame_s = 0, pick_s = 0, gizmo_s = 0, submit_s = 0, overlay_s = 0;
+      for (int i = 0; i < frames; ++i) {
+        cam_set_rotation(&state->cam, state->cam.rotation + Vec3{0, MATH_TAU / frames, 0});
+
+        double start = native_now();
+        frame(dt);
+        frame_s += native_now() - start;
+
+        RayHit hit;
+        start = native_now();
+        pick_world_obj(&state->world, cam_ray(&state->cam), &hit);
+        pick_s += native_now() - start;
+
+        start = native_now();
+        handle_block_gizmos();
+        gizmo_s += native_now() - start;
+
+        start = native_now();
+        render_mesh_regions(&state->world, cam_vp(&state->cam));
+        submit_s += native_now() - start;
+
+        start = native_now();
+        render_overlays(dt);
+        overlay_s += native_now() - start;
+      }
+
+      // what loading it all in costs the mesh regions
+      World *world = &state->world;
+      for (u32 i = 0; i < world->object_count; ++i) {
+        mesh_region_touch(&world->meshes, world_pos(world, i));
+      }
+      double start = native_now();
+      bake_mesh_regions(world);
+      double rebake_s = native_now() - start;
+
+      double us = 1e6 / frames;
+      printf("%-8s %10u %10u %10.1f %10.2f %10.2f %12.1f %10.2f %12.2f\n", layout_names[layout], count,
+             u32(world->object_count), frame_s * us, pick_s * us, gizmo_s * us, rebake_s * 1e6, submit_s * us,
+             overlay_s * us);
+      fprintf(json, "%s\n  {\"layout\": \"%s\", \"objects\": %u, \"resident\": %u, \"frame_us\": %.2f, "
+                    "\"pick_us\": %.2f, \"gizmo_us\": %.2f, \"rebake_us\": %.2f, \"submit_us\": %.2f, "
+                    "\"overlay_us\": %.2f}",
+              first_result ? "" : ",", layout_names[layout], count, u32(world->object_count), frame_s * us,
+              pick_s * us, gizmo_s * us, rebake_s * 1e6, submit_s * us, overlay_s * us);
+      first_result = false;
+    }
+  }
+
+  fprintf(json, "\n]}\n");
+  fclose(json);
+  native_save_close();
+}
+
+/* transform: the Mat4 kernels from math.h, scalar against simd, on a batch the size of a frame's geo */
+#define BENCH_TRANSFORM_VERTS 4096
+#define BENCH_TRANSFORM_MATS 1024
+
+static void bench_transform() {
+  printf("%-10s %14s %14s\n", "variant", "Mverts/s", "Mmat4 mul/s");
+
+  Vert *src = new Vert[BENCH_TRANSFORM_VERTS];
+  Vert *dst = new Vert[BENCH_TRANSFORM_VERTS];
+  for (u32 i = 0; i < BENCH_TRANSFORM_VERTS; ++i) {
+    src[i] = {{bench_random(), bench_random(), bench_random()}, bench_random_dir(), 1.0f};
+  }
+  Mat4 m = m4_translate({1, 2, 3}) * m4_rotate_yxz({0.3f, 0.7f, 0}) * m4_scale({1, 2, 0.5f});
+  Mat4 *models = new Mat4[BENCH_TRANSFORM_MATS];
+  Mat4 *mvps = new Mat4[BENCH_TRANSFORM_MATS];
+
+  const u32 passes = 20000;
+  const u32 muls = 10000000;
+  for (int variant = 0; variant < 2; ++variant) {
+    float sum = 0;
+    for (u32 i = 0; i < BENCH_TRANSFORM_MATS; ++i) {
+      models[i] = m4_translate({bench_random(), bench_random(), bench_random()});
+    }
+
+    double start = native_now();
+    for (u32 pass = 0; pass < passes; ++pass) {
+      // a different matrix every pass so none of it is hoisted out
+      m.num[3][0] = float(pass);
+      if (variant == 0) {
+        transform_points_scalar(m, src, dst, BENCH_TRANSFORM_VERTS);
+      } else {
+        transform_points_simd(m, src, dst, BENCH_TRANSFORM_VERTS);
+      }
+      sum += dst[pass % BENCH_TRANSFORM_VERTS].pos.x;
+    }
+    double verts_per_s = double(passes) * BENCH_TRANSFORM_VERTS / (native_now() - start);
+
+    // model matrices times a view projection, like baking or drawing objects does
+    start = native_now();
+    for (u32 i = 0; i < muls; ++i) {
+      u32 at = i % BENCH_TRANSFORM_MATS;
+      mvps[at] = variant == 0 ? m4_mul_scalar(m, models[at]) : m4_mul_simd(m, models[at]);
+    }
+    double muls_per_s = muls / (native_now() - start);
+    sum += mvps[0].num[1][1];
+
+    printf("%-10s %14.1f %14.1f\n", variant == 0 ? "scalar" : "simd", verts_per_s * 1e-6, muls_per_s * 1e-6);
+    if (sum == 12345.0f) {
+      printf("\n");
+    }
+  }
+
+  delete[] src;
+  delete[] dst;
+  delete[] models;
+  delete[] mvps;
+}
+
+/* log: the debug overlay's text through tsprintf, against copying the same number of bytes. most of what's
+ * left between the two is the shortest round trip of the float (grisu2), the rest are a few ns each */
+static void bench_log() {
+  printf("%-10s %12s %12s %12s\n", "variant", "ns/call", "bytes", "GB/s");
+
+  const u32 calls = 1000000;
+  float sum = 0;
+  char text[LOG_LINE_SIZE + 1];
+  LogBuffer buffer = {text, 0, LOG_LINE_SIZE};
+  double start = native_now();
+  for (u32 i = 0; i < calls; ++i) {
+    float f = float(i) * 0.001f;
+    buffer.length = 0;
+    tsprintf(&buffer,
+             "- Debug Info\n"
+             "\t> Object count: {}\n"
+             "\t> Culled objects: {}/{}\n"
+             "\t- Camera\n"
+             "\t\t> Position: ({}, {}, {})\n"
+             "\t\t> Rotation: ({}, {})\n"
+             "\t> DeltaTime: {}s\n"
+             "\t> GeoIndices: {}\n"
+             "\t> GeoVertices: {}\n"
+             "\t> GeoFlushGen: {}\n",
+             int(i), int(i / 3), int(i), LogFixed{f, 2}, LogFixed{-f, 2}, LogFixed{f * 2, 2}, int(i % 360),
+             -int(i % 90), 0.016f + f * 1e-6f, int(i), int(i * 2), 3);
+    sum += log_buffer_text(&buffer)[buffer.length / 2];
+  }
+  double tsprintf_ns = (native_now() - start) / calls * 1e9;
+  usize length = buffer.length;
+
+  char copy[LOG_LINE_SIZE];
+  start = native_now();
+  for (u32 i = 0; i < calls; ++i) {
+    text[0] = char(i);
+    __builtin_memcpy(copy, text, length);
+    asm volatile("" ::: "memory");
+    sum += copy[length / 2];
+  }
+  double memcpy_ns = (native_now() - start) / calls * 1e9;
+
+  printf("%-10s %12.1f %12u %12.2f\n", "tsprintf", tsprintf_ns, length, length / tsprintf_ns);
+  printf("%-10s %12.1f %12u %12.2f\n", "memcpy", memcpy_ns, length, length / memcpy_ns);
+  if (sum == 12345.0f) {
+    printf("\n");
+  }
+}
+
+/* float: log_put's float formatting, the six truncated decimals it had before against the shortest
+ * round trip and LogFixed. "round trip" is the share that reads back as the same float */
+#define BENCH_FLOAT_VALUES 4096
+
+// the formatter for doubles the log used to have
+static usize bench_float_old(char *out, double v) {
+  char *at = out;
+  if (v < 0) {
+    v = -v;
+    *at++ = '-';
+  }
+  u64 whole = v < 18446744073709551615.0 ? u64(v) : ~u64(0);
+  u32 frac = v < 18446744073709551615.0 ? u32((v - double(whole)) * 1000000) : 0;
+  char digits[20];
+  int count = 0;
+  do {
+    digits[count++] = char('0' + whole % 10);
+    whole /= 10;
+  } while (whole != 0);
+  while (count > 0) {
+    *at++ = digits[--count];
+  }
+  *at++ = '.';
+  for (u32 scale = 100000; scale != 0; scale /= 10) {
+    *at++ = char('0' + frac / scale % 10);
+  }
+  return at - out;
+}
+
+static void bench_float() {
+  printf("%-10s %12s %12s %12s\n", "variant", "ns/value", "chars", "round trip");
+
+  // world coordinates, timings and a few far out ones
+  float *values = new float[BENCH_FLOAT_VALUES];
+  for (u32 i = 0; i < BENCH_FLOAT_VALUES; ++i) {
+    float scale = i % 16 == 0 ? 1e12f : i % 4 == 0 ? 0.02f : 500.0f;
+    values[i] = (bench_random() - 0.5f) * 2 * scale;
+  }
+
+  const char *names[] = {"old", "shortest", "fixed 2"};
+  const u32 passes = 500;
+  for (int variant = 0; variant < 3; ++variant) {
+    char out[LOG_FLOAT_CHARS + 1];
+    usize chars = 0;
+    double start = native_now();
+    for (u32 pass = 0; pass < passes; ++pass) {
+      for (u32 i = 0; i < BENCH_FLOAT_VALUES; ++i) {
+        float v = values[i];
+        chars += variant == 0 ? bench_float_old(out, v) :
+                 variant == 1 ? log_format_float(out, v) : log_format_fixed(out, v, 2);
+      }
+    }
+    double ns = (native_now() - start) / (double(passes) * BENCH_FLOAT_VALUES) * 1e9;
+
+    u32 exact = 0;
+    for (u32 i = 0; i < BENCH_FLOAT_VALUES; ++i) {
+      float v = values[i], back = 0;
+      usize length = variant == 0 ? bench_float_old(out, v) :
+                     variant == 1 ? log_format_float(out, v) : log_format_fixed(out, v, 2);
+      out[length] = '\0';
+      sscanf(out, "%f", &back);
+      exact += back == v;
+    }
+
+    printf("%-10s %12.1f %12.1f %11.1f%%\n", names[variant], ns, double(chars) / (double(passes) * BENCH_FLOAT_VALUES),
+           100.0 * exact / BENCH_FLOAT_VALUES);
+  }
+  delete[] values;
+}
+
+struct Bench {
+  const char *name;
+  void (*run)();
+};
+
+static Bench benches[] = {
+  {"bvh", bench_bvh},
+  {"soa", bench_soa},
+  {"stream", bench_stream},
+  {"save", bench_save},
+  {"frame", bench_frame},
+  {"transform", bench_transform},
+  {"log", bench_log},
+  {"float", bench_float},
+};
+
+int main(int argc, char **argv) {
+  init();
+  for (Bench &bench : benches) {
+    bool selected = argc < 2;
+    for (int i = 1; i < argc; ++i) {
+      selected |= strcmp(argv[i], bench.name) == 0;
+    }
+
+    if (selected) {
+      printf("== %s\n", bench.name);
+      bench.run();
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,10 @@
+# native benchmarks: ./bench.sh [name...]
+mkdir -p build
+cd build
+
+${CXX:-zig c++} \
+  -O2 \
+  -std=c++20 \
+  -o bench \
+  ../bench.cpp ../platform_native.cpp ../platform.cpp ../gen.cpp ../log.cpp ../profile.cpp \
+  && ./bench "$@"
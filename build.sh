@@ -1,3 +1,10 @@
+# ./build.sh [profile], rebuilds build/main.wasm every second. profile builds in the profiler's zones
+# (profile.h), which cost a time_now call on each side of every zone
+FLAGS=
+if [ "$1" = profile ]; then
+  FLAGS=-DPROFILE
+fi
+
 mkdir -p build
 cd build
 
@@ -7,7 +14,10 @@ do
   zig build-lib \
     -O Debug \
     -rdynamic \
-    -dynamic -target wasm32-freestanding ../main.cpp ../platform.cpp ../gen.cpp ../log.cpp
+    $FLAGS \
+    -dynamic -target wasm32-freestanding -mcpu generic+simd128 \
+    -cflags -std=c++20 -- \
+    ../main.cpp ../platform.cpp ../gen.cpp ../log.cpp ../profile.cpp
 
   sleep 1
 done
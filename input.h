@@ -0,0 +1,69 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "platform.h"
+
+/* the KeyboardEvent.code values the game knows, the host puts their index in the input ring (see
+ * input_scancode_name). anything else is never bound so it isn't sent */
+#define SCANCODES(X) \
+  X(KeyA) X(KeyB) X(KeyC) X(KeyD) X(KeyE) X(KeyF) X(KeyG) X(KeyH) X(KeyI) X(KeyJ) X(KeyK) X(KeyL) X(KeyM) \
+  X(KeyN) X(KeyO) X(KeyP) X(KeyQ) X(KeyR) X(KeyS) X(KeyT) X(KeyU) X(KeyV) X(KeyW) X(KeyX) X(KeyY) X(KeyZ) \
+  X(Digit0) X(Digit1) X(Digit2) X(Digit3) X(Digit4) X(Digit5) X(Digit6) X(Digit7) X(Digit8) X(Digit9) \
+  X(F1) X(F2) X(F3) X(F4) X(F5) X(F6) X(F7) X(F8) X(F9) X(F10) X(F11) X(F12) \
+  X(Space) X(Enter) X(Escape) X(Tab) X(Backspace) X(CapsLock) \
+  X(ShiftLeft) X(ShiftRight) X(ControlLeft) X(ControlRight) X(AltLeft) X(AltRight) \
+  X(ArrowUp) X(ArrowDown) X(ArrowLeft) X(ArrowRight) \
+  X(Minus) X(Equal) X(BracketLeft) X(BracketRight) X(Backslash) X(Semicolon) X(Quote) X(Backquote) \
+  X(Comma) X(Period) X(Slash)
+
+enum Scancode {
+  Scancode_None,
+#define SCANCODE_ENUM(name) Scancode_##name,
+  SCANCODES(SCANCODE_ENUM)
+#undef SCANCODE_ENUM
+  Scancode_COUNT
+};
+
+constexpr const char *scancode_names[Scancode_COUNT] = {
+  "",
+#define SCANCODE_NAME(name) #name,
+  SCANCODES(SCANCODE_NAME)
+#undef SCANCODE_NAME
+};
+
+/* perfect hash from the names above back to their Scancode, built by the compiler: it tries seeds until
+ * every name lands in a slot of its own. a lookup is one hash and one compare, however many there are */
+#define SCANCODE_TABLE_SIZE 1024
+static_assert(Scancode_COUNT <= 256, "scancodes don't fit in the table's u8s");
+
+struct ScancodeTable {
+  u32 seed;
+  u8 codes[SCANCODE_TABLE_SIZE]; // Scancode_None where nothing lands
+};
+
+constexpr u32 scancode_hash(const char *name, u32 seed) {
+  u32 hash = 2166136261u ^ seed;
+  for (; *name; ++name) {
+    hash = (hash ^ u8(*name)) * 16777619u;
+  }
+  return (hash ^ (hash >> 15)) & (SCANCODE_TABLE_SIZE - 1);
+}
+
+constexpr ScancodeTable scancode_table_make() {
+  for (u32 seed = 0; ; ++seed) {
+    ScancodeTable table = {seed, {}}; // Scancode_None is 0
+    bool collided = false;
+    for (int code = 1; code < Scancode_COUNT && !collided; ++code) {
+      u32 slot = scancode_hash(scancode_names[code], seed);
+      collided = table.codes[slot] != Scancode_None;
+      table.codes[slot] = u8(code);
+    }
+    if (!collided) {
+      return table;
+    }
+  }
+}
+
+constexpr ScancodeTable scancode_table = scancode_table_make();
+
+#endif
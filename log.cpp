@@ -1,74 +1,452 @@
 #include "log.h"
 
-char log_cache[LOG_CACHE_SIZE+1];
-usize log_cache_length = 0;
-bool log_noflush = false;
+static char log_line_text[LOG_LINE_SIZE + 1];
+LogBuffer log_lines = {log_line_text, 0, LOG_LINE_SIZE};
+LogRing log_ring;
 
-char *flush() {
-  log_cache[log_cache_length] = 0;
-  log_cache_length = 0;
+void log_buffer_append(LogBuffer *buffer, const char *s, usize n) {
+  if (n > buffer->capacity - buffer->length) {
+    __atomic_fetch_add(&log_ring.dropped, 1, __ATOMIC_RELAXED);
+    n = buffer->capacity - buffer->length;
+  }
+  __builtin_memcpy(buffer->data + buffer->length, s, n);
+  buffer->length += n;
+}
 
-  return log_cache;
+const char *log_buffer_text(LogBuffer *buffer) {
+  buffer->data[buffer->length] = '\0';
+  return buffer->data;
 }
 
-void putval(char c) {
-  if (log_cache_length >= LOG_CACHE_SIZE) {
-    console_log_n("Log cache exhausted", 19);
-    return;
+void log_lines_send() {
+  char *start = log_lines.data, *end = log_lines.data + log_lines.length;
+  for (char *at = start; at != end; ++at) {
+    if (*at == '\n') {
+      log_push(LogLevel_Info, LogCategory_General, start, at - start);
+      start = at + 1;
+    }
   }
-  if (c == '\n' && log_noflush == false) {
-    console_log_n(log_cache, log_cache_length);
-    log_cache_length = 0;
-  } else {
-    log_cache[log_cache_length++] = c;
+  log_lines.length = end - start;
+  __builtin_memmove(log_lines.data, start, log_lines.length);
+}
+
+static const char log_digit_pairs[] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+static const u64 log_pow10[20] = {
+  1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull, 1000000000ull,
+  10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull, 100000000000000ull,
+  1000000000000000ull, 10000000000000000ull, 100000000000000000ull, 1000000000000000000ull,
+  10000000000000000000ull,
+};
+
+// from the bit length, 1233 / 2^12 is log10(2), then one compare to see which side of the power it is on
+static u32 log_digit_count(u64 v) {
+  v |= 1; // same count, and 0 has one digit
+  u32 bits = 64 - __builtin_clzll(v);
+  u32 guess = (bits * 1233) >> 12;
+  return guess + 1 - (v < log_pow10[guess]);
+}
+
+// the last `count` digits of `v` ending at `end`, two at a time. 32 bit values stay in 32 bit math
+template <typename T>
+static void log_digits(T v, char *end, u32 count) {
+  char *at = end;
+  for (; count >= 2; count -= 2) {
+    u32 pair = u32(v % 100) * 2;
+    v /= 100;
+    *--at = log_digit_pairs[pair + 1];
+    *--at = log_digit_pairs[pair];
+  }
+  if (count != 0) {
+    *--at = char('0' + v % 10);
   }
 }
 
-void putval(const char *s) {
-  while (*s) {
-    putval(*s++);
+char *log_put(char *at, int v) {
+  u32 magnitude = v < 0 ? 0u - u32(v) : u32(v);
+  u32 digits = log_digit_count(magnitude);
+  if (v < 0) {
+    *at++ = '-';
   }
+  log_digits(magnitude, at + digits, digits);
+  return at + digits;
 }
 
-void putval(int v) {
-  char buf[16] = { 0 };
-  int i = 0;
+/* floats print the fewest digits that read back as the same value, found with grisu2 (Loitsch, "Printing
+ * Floating-Point Numbers Quickly and Accurately with Integers"). a float is held to its own neighbours,
+ * not a double's, so 0.1f is 0.1. it works in 64 bit integers, no divisions per digit past the first few */
+struct LogDiyFp {
+  u64 f;
+  int e; // value is f * 2^e
+};
 
-  if (v == 0) {
-    putval('0');
-    return;
+static LogDiyFp log_diyfp_normalize(LogDiyFp x) {
+  int shift = __builtin_clzll(x.f);
+  return {x.f << shift, x.e - shift};
+}
+
+// the top half of the 128 bit product, rounded
+static LogDiyFp log_diyfp_mul(LogDiyFp x, LogDiyFp y) {
+  u64 x_lo = x.f & 0xffffffffu, x_hi = x.f >> 32;
+  u64 y_lo = y.f & 0xffffffffu, y_hi = y.f >> 32;
+  u64 lo_lo = x_lo * y_lo, lo_hi = x_lo * y_hi, hi_lo = x_hi * y_lo, hi_hi = x_hi * y_hi;
+  u64 middle = (lo_lo >> 32) + (lo_hi & 0xffffffffu) + (hi_lo & 0xffffffffu) + (1ull << 31);
+  return {hi_hi + (lo_hi >> 32) + (hi_lo >> 32) + (middle >> 32), x.e + y.e + 64};
+}
+
+// the value and the points halfway to its neighbours below and above, all with plus's exponent
+struct LogBoundaries {
+  LogDiyFp w, minus, plus;
+};
+
+// `bits` without the sign, `precision` counts the hidden bit
+static LogBoundaries log_boundaries(u64 bits, int precision, int bias) {
+  u64 hidden = 1ull << (precision - 1);
+  u64 fraction = bits & (hidden - 1);
+  int exponent = int(bits >> (precision - 1));
+  LogDiyFp v = exponent == 0 ? LogDiyFp{fraction, 1 - bias} : LogDiyFp{fraction + hidden, exponent - bias};
+
+  // at a power of two the neighbour below is half as far away
+  bool lower_closer = fraction == 0 && exponent > 1;
+  LogDiyFp plus = log_diyfp_normalize({2 * v.f + 1, v.e - 1});
+  LogDiyFp minus = lower_closer ? LogDiyFp{4 * v.f - 1, v.e - 2} : LogDiyFp{2 * v.f - 1, v.e - 1};
+  minus = {minus.f << (minus.e - plus.e), plus.e};
+  return {log_diyfp_normalize(v), minus, plus};
+}
+
+// 10^k, every 8th from 10^-300 to 10^340, normalized and rounded to nearest
+struct LogCachedPower {
+  u64 f;
+  int e, k;
+};
+
+static const LogCachedPower log_cached_powers[] = {
+  {0xAB70FE17C79AC6CA, -1060, -300}, {0xFF77B1FCBEBCDC4F, -1034, -292},
+  {0xBE5691EF416BD60C, -1007, -284}, {0x8DD01FAD907FFC3C, -980, -276},
+  {0xD3515C2831559A83, -954, -268}, {0x9D71AC8FADA6C9B5, -927, -260},
+  {0xEA9C227723EE8BCB, -901, -252}, {0xAECC49914078536D, -874, -244},
+  {0x823C12795DB6CE57, -847, -236}, {0xC21094364DFB5637, -821, -228},
+  {0x9096EA6F3848984F, -794, -220}, {0xD77485CB25823AC7, -768, -212},
+  {0xA086CFCD97BF97F4, -741, -204}, {0xEF340A98172AACE5, -715, -196},
+  {0xB23867FB2A35B28E, -688, -188}, {0x84C8D4DFD2C63F3B, -661, -180},
+  {0xC5DD44271AD3CDBA, -635, -172}, {0x936B9FCEBB25C996, -608, -164},
+  {0xDBAC6C247D62A584, -582, -156}, {0xA3AB66580D5FDAF6, -555, -148},
+  {0xF3E2F893DEC3F126, -529, -140}, {0xB5B5ADA8AAFF80B8, -502, -132},
+  {0x87625F056C7C4A8B, -475, -124}, {0xC9BCFF6034C13053, -449, -116},
+  {0x964E858C91BA2655, -422, -108}, {0xDFF9772470297EBD, -396, -100},
+  {0xA6DFBD9FB8E5B88F, -369, -92}, {0xF8A95FCF88747D94, -343, -84},
+  {0xB94470938FA89BCF, -316, -76}, {0x8A08F0F8BF0F156B, -289, -68},
+  {0xCDB02555653131B6, -263, -60}, {0x993FE2C6D07B7FAC, -236, -52},
+  {0xE45C10C42A2B3B06, -210, -44}, {0xAA242499697392D3, -183, -36},
+  {0xFD87B5F28300CA0E, -157, -28}, {0xBCE5086492111AEB, -130, -20},
+  {0x8CBCCC096F5088CC, -103, -12}, {0xD1B71758E219652C, -77, -4},
+  {0x9C40000000000000, -50, 4}, {0xE8D4A51000000000, -24, 12},
+  {0xAD78EBC5AC620000, 3, 20}, {0x813F3978F8940984, 30, 28},
+  {0xC097CE7BC90715B3, 56, 36}, {0x8F7E32CE7BEA5C70, 83, 44},
+  {0xD5D238A4ABE98068, 109, 52}, {0x9F4F2726179A2245, 136, 60},
+  {0xED63A231D4C4FB27, 162, 68}, {0xB0DE65388CC8ADA8, 189, 76},
+  {0x83C7088E1AAB65DB, 216, 84}, {0xC45D1DF942711D9A, 242, 92},
+  {0x924D692CA61BE758, 269, 100}, {0xDA01EE641A708DEA, 295, 108},
+  {0xA26DA3999AEF774A, 322, 116}, {0xF209787BB47D6B85, 348, 124},
+  {0xB454E4A179DD1877, 375, 132}, {0x865B86925B9BC5C2, 402, 140},
+  {0xC83553C5C8965D3D, 428, 148}, {0x952AB45CFA97A0B3, 455, 156},
+  {0xDE469FBD99A05FE3, 481, 164}, {0xA59BC234DB398C25, 508, 172},
+  {0xF6C69A72A3989F5C, 534, 180}, {0xB7DCBF5354E9BECE, 561, 188},
+  {0x88FCF317F22241E2, 588, 196}, {0xCC20CE9BD35C78A5, 614, 204},
+  {0x98165AF37B2153DF, 641, 212}, {0xE2A0B5DC971F303A, 667, 220},
+  {0xA8D9D1535CE3B396, 694, 228}, {0xFB9B7CD9A4A7443C, 720, 236},
+  {0xBB764C4CA7A44410, 747, 244}, {0x8BAB8EEFB6409C1A, 774, 252},
+  {0xD01FEF10A657842C, 800, 260}, {0x9B10A4E5E9913129, 827, 268},
+  {0xE7109BFBA19C0C9D, 853, 276}, {0xAC2820D9623BF429, 880, 284},
+  {0x80444B5E7AA7CF85, 907, 292}, {0xBF21E44003ACDD2D, 933, 300},
+  {0x8E679C2F5E44FF8F, 960, 308}, {0xD433179D9C8CB841, 986, 316},
+  {0x9E19DB92B4E31BA9, 1013, 324}, {0xEB96BF6EBADF77D9, 1039, 332},
+  {0xAF87023B9BF0EE6B, 1066, 340},
+};
+
+// the cached power scales the exponent into [-60, -32], so the whole digits fit a u32 and the rest a u64
+#define LOG_GRISU_ALPHA -60
+
+static LogCachedPower log_cached_power(int e) {
+  // the smallest k with 10^k * 2^e >= 2^alpha, 78913 / 2^18 is log10(2)
+  int f = LOG_GRISU_ALPHA - e - 1;
+  int k = (f * 78913) / (1 << 18) + (f > 0);
+  return log_cached_powers[(300 + k + 7) / 8];
+}
+
+// steps the last digit down while that gets closer to the value without leaving the interval
+static void log_grisu2_round(char *digits, int length, u64 dist, u64 delta, u64 rest, u64 ten_k) {
+  while (rest < dist && delta - rest >= ten_k && (rest + ten_k < dist || dist - rest > rest + ten_k - dist)) {
+    digits[length - 1]--;
+    rest += ten_k;
   }
+}
 
-  if (v < 0) {
-    v *= -1;
-    putval('-');
+// the shortest digits strictly inside (minus, plus), closest to w. the value is digits * 10^exponent
+static int log_grisu2(char *digits, int *exponent, LogBoundaries b) {
+  LogCachedPower cached = log_cached_power(b.plus.e);
+  LogDiyFp c = {cached.f, cached.e};
+  LogDiyFp w = log_diyfp_mul(b.w, c);
+  LogDiyFp minus = log_diyfp_mul(b.minus, c);
+  LogDiyFp plus = log_diyfp_mul(b.plus, c);
+  // the products can be off by one either way, narrow the interval so every digit in it is still safe
+  minus.f++;
+  plus.f--;
+  *exponent = -cached.k;
+
+  u64 delta = plus.f - minus.f;
+  u64 dist = plus.f - w.f;
+  int shift = -plus.e;
+  u64 one = 1ull << shift;
+  u32 whole = u32(plus.f >> shift);
+  u64 frac = plus.f & (one - 1);
+
+  // all of the whole part's digits at once, then as few of them as the interval allows
+  int length = log_digit_count(whole);
+  log_digits(whole, digits + length, length);
+  u32 prefix = 0;
+  for (int k = 1; k <= length; ++k) {
+    prefix = prefix * 10 + u32(digits[k - 1] - '0');
+    u32 pow10 = u32(log_pow10[length - k]);
+    u64 rest = (u64(whole - prefix * pow10) << shift) + frac;
+    if (rest <= delta) {
+      *exponent += length - k;
+      log_grisu2_round(digits, k, dist, delta, rest, u64(pow10) << shift);
+      return k;
+    }
   }
 
-  while (v > 0) {
-    buf[i++] = v % 10 + '0';
-    v /= 10;
+  int m = 0;
+  for (;;) {
+    frac *= 10;
+    digits[length++] = char('0' + (frac >> shift));
+    frac &= one - 1;
+    m++;
+    delta *= 10;
+    dist *= 10;
+    if (frac <= delta) {
+      break;
+    }
   }
+  *exponent -= m;
+  log_grisu2_round(digits, length, dist, delta, frac, one);
+  return length;
+}
+
+// plain decimals while the point is this close to the digits, 1.5e+20 and 1e-05 past it
+#define LOG_FLOAT_MIN_POINT -4
+#define LOG_FLOAT_MAX_POINT 15
 
-  while (i--) {
-    putval(buf[i]);
+// digits * 10^exponent as 1230.0, 12.5, 0.0125 or 1.25e+20
+static usize log_place_point(char *out, const char *digits, int length, int exponent) {
+  int point = length + exponent; // digits before the point
+  char *at = out;
+  if (length <= point && point <= LOG_FLOAT_MAX_POINT) {
+    __builtin_memcpy(at, digits, length);
+    __builtin_memset(at + length, '0', point - length);
+    at += point;
+    *at++ = '.';
+    *at++ = '0';
+  } else if (0 < point && point <= LOG_FLOAT_MAX_POINT) {
+    __builtin_memcpy(at, digits, point);
+    at[point] = '.';
+    __builtin_memcpy(at + point + 1, digits + point, length - point);
+    at += length + 1;
+  } else if (LOG_FLOAT_MIN_POINT < point && point <= 0) {
+    *at++ = '0';
+    *at++ = '.';
+    __builtin_memset(at, '0', -point);
+    __builtin_memcpy(at - point, digits, length);
+    at += length - point;
+  } else {
+    *at++ = digits[0];
+    if (length > 1) {
+      *at++ = '.';
+      __builtin_memcpy(at, digits + 1, length - 1);
+      at += length - 1;
+    }
+    int e = point - 1;
+    *at++ = 'e';
+    *at++ = e < 0 ? '-' : '+';
+    u32 magnitude = e < 0 ? -e : e;
+    u32 count = magnitude < 10 ? 2 : log_digit_count(magnitude);
+    log_digits(magnitude, at + count, count);
+    at += count;
   }
+  return at - out;
 }
 
-void putval(double v) {
-  if (v < 0) {
-    v *= -1;
-    putval('-');
+// `precision` significand bits counting the hidden one
+static usize log_format_shortest(char *out, u64 bits, int precision, int exponent_bits) {
+  u64 sign = 1ull << (precision - 1 + exponent_bits);
+  u64 magnitude = bits & (sign - 1);
+  u64 infinity = ((1ull << exponent_bits) - 1) << (precision - 1);
+  char *at = out;
+  if (magnitude > infinity) {
+    __builtin_memcpy(at, "nan", 3);
+    return 3;
+  }
+  if ((bits & sign) != 0) {
+    *at++ = '-';
+  }
+  if (magnitude == infinity) {
+    __builtin_memcpy(at, "inf", 3);
+    return at + 3 - out;
+  }
+  if (magnitude == 0) {
+    __builtin_memcpy(at, "0.0", 3);
+    return at + 3 - out;
+  }
+
+  char digits[24];
+  int exponent;
+  int bias = (1 << (exponent_bits - 1)) - 1 + precision - 1;
+  int length = log_grisu2(digits, &exponent, log_boundaries(magnitude, precision, bias));
+  return at - out + log_place_point(at, digits, length, exponent);
+}
+
+usize log_format_double(char *out, double v) {
+  u64 bits;
+  __builtin_memcpy(&bits, &v, sizeof(bits));
+  return log_format_shortest(out, bits, 53, 11);
+}
+
+usize log_format_float(char *out, float v) {
+  u32 bits;
+  __builtin_memcpy(&bits, &v, sizeof(bits));
+  return log_format_shortest(out, bits, 24, 8);
+}
+
+// a * b == product + error exactly (Dekker), the error is what rounding the product lost
+static double log_two_product(double a, double b, double *error) {
+  double product = a * b;
+  double a_split = 134217729.0 * a, b_split = 134217729.0 * b;
+  double a_hi = a_split - (a_split - a), a_lo = a - a_hi;
+  double b_hi = b_split - (b_split - b), b_lo = b - b_hi;
+  *error = ((a_hi * b_hi - product) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+  return product;
+}
+
+usize log_format_fixed(char *out, double v, int decimals) {
+  decimals = decimals < 0 ? 0 : decimals > LOG_FIXED_MAX_DECIMALS ? LOG_FIXED_MAX_DECIMALS : decimals;
+  double error;
+  double scaled = log_two_product(v < 0 ? -v : v, double(log_pow10[decimals]), &error);
+  // too big to scale into a u64, or nan
+  if (!(scaled < 9e18)) {
+    return log_format_double(out, v);
+  }
+
+  // rounded from the exact product, half way goes to even like printf
+  u64 rounded = u64(scaled);
+  double rest = scaled - double(rounded);
+  if (rest > 0.5 || (rest == 0.5 && (error > 0 || (error == 0 && (rounded & 1) != 0)))) {
+    rounded++;
+  }
+
+  u64 whole = rounded / log_pow10[decimals];
+  char *at = out;
+  if (v < 0 && rounded != 0) {
+    *at++ = '-';
+  }
+  u32 count = log_digit_count(whole);
+  log_digits(whole, at + count, count);
+  at += count;
+  if (decimals > 0) {
+    *at++ = '.';
+    log_digits(rounded - whole * log_pow10[decimals], at + decimals, decimals);
+    at += decimals;
+  }
+  return at - out;
+}
+
+char *log_put(char *at, double v) {
+  return at + log_format_double(at, v);
+}
+
+char *log_put(char *at, float v) {
+  return at + log_format_float(at, v);
+}
+
+char *log_put(char *at, LogFixed v) {
+  return at + log_format_fixed(at, v.value, v.decimals);
+}
+
+static const char log_level_letters[LogLevel_COUNT] = {'D', 'I', 'W', 'E'};
+
+static const char *log_category_names[LogCategory_COUNT] = {
+#define LOG_CATEGORY_NAME(name) #name,
+  LOG_CATEGORIES(LOG_CATEGORY_NAME)
+#undef LOG_CATEGORY_NAME
+};
+
+// "W Chunk: ", returns its length
+static usize log_entry_prefix(char *out, LogLevel level, LogCategory category) {
+  const char *name = log_category_names[category];
+  usize length = 0;
+  out[length++] = log_level_letters[level];
+  out[length++] = ' ';
+  for (; *name != '\0'; ++name) {
+    out[length++] = *name;
   }
+  out[length++] = ':';
+  out[length++] = ' ';
+  return length;
+}
 
-  putval(int(v));
-  putval('.');
-  putval(int((v-int(v)) * 1000000));
+static void log_ring_put(u32 at, const char *s, usize n) {
+  u32 offset = at % LOG_RING_SIZE;
+  usize first = n < LOG_RING_SIZE - offset ? n : LOG_RING_SIZE - offset;
+  __builtin_memcpy(log_ring.data + offset, s, first);
+  __builtin_memcpy(log_ring.data, s + first, n - first);
 }
 
-void putval(float v) {
-  putval(double(v));
+void log_push(LogLevel level, LogCategory category, const char *text, usize length) {
+  char prefix[32];
+  usize prefix_length = log_entry_prefix(prefix, level, category);
+  usize size = prefix_length + length + 1;
+
+  u32 write = log_ring.write;
+  u32 read = __atomic_load_n(&log_ring.read, __ATOMIC_ACQUIRE);
+  if (size > LOG_RING_SIZE - (write - read)) {
+    __atomic_fetch_add(&log_ring.dropped, 1, __ATOMIC_RELAXED);
+    return;
+  }
+
+  log_ring_put(write, prefix, prefix_length);
+  log_ring_put(write + prefix_length, text, length);
+  log_ring_put(write + prefix_length + length, "", 1);
+  __atomic_store_n(&log_ring.write, write + size, __ATOMIC_RELEASE);
 }
 
-void tprintf(const char* format) {
-  putval(format);
-}
\ No newline at end of file
+// room for a full ring and the note about what was dropped
+static char log_batch[LOG_RING_SIZE + 64];
+
+void log_flush_frame() {
+  u32 read = log_ring.read;
+  u32 write = __atomic_load_n(&log_ring.write, __ATOMIC_ACQUIRE);
+  u32 dropped = __atomic_exchange_n(&log_ring.dropped, 0, __ATOMIC_RELAXED);
+  if (read == write && dropped == 0) {
+    return;
+  }
+
+  usize size = write - read;
+  u32 offset = read % LOG_RING_SIZE;
+  usize first = size < LOG_RING_SIZE - offset ? size : LOG_RING_SIZE - offset;
+  __builtin_memcpy(log_batch, log_ring.data + offset, first);
+  __builtin_memcpy(log_batch + first, log_ring.data, size - first);
+  __atomic_store_n(&log_ring.read, write, __ATOMIC_RELEASE);
+
+  if (dropped != 0) {
+    const char note[] = " log entries dropped";
+    size += log_entry_prefix(log_batch + size, LogLevel_Warn, LogCategory_General);
+    u32 digits = log_digit_count(dropped);
+    log_digits(dropped, log_batch + size + digits, digits);
+    size += digits;
+    // its '\0' ends the entry
+    __builtin_memcpy(log_batch + size, note, sizeof(note));
+    size += sizeof(note);
+  }
+
+  console_log_batch(log_batch, size);
+}
@@ -3,34 +3,241 @@
 
 #include "platform.h"
 
-#define LOG_CACHE_SIZE (1 << 11)
-extern char log_cache[LOG_CACHE_SIZE+1];
-extern usize log_cache_length;
-extern bool log_noflush;
-
-char *flush();
-void putval(char c);
-void putval(const char *s);
-void putval(int v);
-void putval(double v);
-void putval(float v);
-void tprintf(const char* format);
-
-// SKEJETON: I know CEDRIC.. you are going to kill me for this:
-template<typename T, typename... Targs>
-void tprintf(const char* format, T value, Targs... Fargs) {
-  for (; *format != '\0'; format++) {
-    if (*format == '{' && format[1] == '{') {
-      format += 1;
-    } else if (*format == '}' && format[1] == '}') {
-      format += 1;
-    } else if (*format == '{' && format[1] == '}') {
-      putval(value);
-      tprintf(format + 2, Fargs...); 
-      return;
-    } 
-    putval(*format);
+/* where formatted text goes: tsprintf(&buffer, ...) adds to data, '\n' included. what doesn't fit in capacity
+ * is cut off and counted in log_ring.dropped, capacity leaves room for the '\0' of log_buffer_text */
+struct LogBuffer {
+  char *data;
+  usize length, capacity;
+};
+
+void log_buffer_append(LogBuffer *buffer, const char *s, usize n);
+const char *log_buffer_text(LogBuffer *buffer); // zero terminates it
+
+/* a float with a set number of decimals, tprintf("{}", LogFixed{x, 2}). without it floats get the fewest
+ * digits that read back as the same value */
+#define LOG_FIXED_MAX_DECIMALS 9
+
+struct LogFixed {
+  double value;
+  int decimals; // rounded, up to LOG_FIXED_MAX_DECIMALS
+};
+
+// the same into `out`, which needs LOG_FLOAT_CHARS. they return the length, nothing is zero terminated
+#define LOG_FLOAT_CHARS 32
+usize log_format_double(char *out, double v);
+usize log_format_float(char *out, float v);
+usize log_format_fixed(char *out, double v, int decimals);
+
+/* an argument's text at `at`, which has room for log_put_size of it. they return the end */
+inline char *log_put(char *at, char c) {
+  *at = c;
+  return at + 1;
+}
+
+inline char *log_put(char *at, const char *s) {
+  usize n = __builtin_strlen(s);
+  __builtin_memcpy(at, s, n);
+  return at + n;
+}
+
+char *log_put(char *at, int v);
+char *log_put(char *at, double v);
+char *log_put(char *at, float v);
+char *log_put(char *at, LogFixed v);
+
+inline usize log_put_size(char) { return 1; }
+inline usize log_put_size(const char *s) { return __builtin_strlen(s); }
+inline usize log_put_size(int) { return 11; }
+inline usize log_put_size(double) { return LOG_FLOAT_CHARS; }
+inline usize log_put_size(float) { return LOG_FLOAT_CHARS; }
+inline usize log_put_size(LogFixed) { return LOG_FLOAT_CHARS; }
+
+/* tsprintf(&buffer, "x = {}, y = {}\n", x, y): each {} is the next argument, {{ and }} are a brace. the format
+ * is taken apart by the compiler, so one with the wrong number of {} or a stray brace doesn't build,
+ * and what's left at runtime is one copy per run of text and a log_put per argument */
+#define LOG_FORMAT_RUNS 32
+
+struct LogRun {
+  u16 start = 0, length = 0; // text in the format
+  bool arg = false; // the next argument goes after it
+};
+
+// not constexpr, so the parser reaching it is a compile error that shows the reason
+void log_format_error(const char *reason);
+
+template <typename T> struct LogIdentity { using Type = T; };
+
+template <typename... Args>
+struct LogFormat {
+  const char *format;
+  LogRun runs[LOG_FORMAT_RUNS];
+  u32 run_count;
+  u32 text_length; // of all the runs
+
+  consteval LogFormat(const char *format) : format(format), runs(), run_count(0), text_length(0) {
+    u32 args = 0, start = 0, i = 0;
+    auto push = [&](u32 end, bool arg) {
+      if (run_count == LOG_FORMAT_RUNS) {
+        log_format_error("too many runs of text and {} in the format, raise LOG_FORMAT_RUNS");
+      }
+      runs[run_count++] = {u16(start), u16(end - start), arg};
+      text_length += end - start;
+    };
+
+    for (; format[i] != '\0'; ++i) {
+      char c = format[i];
+      if ((c == '{' && format[i + 1] == '{') || (c == '}' && format[i + 1] == '}')) {
+        push(i + 1, false);
+        start = ++i + 1;
+      } else if (c == '{' && format[i + 1] == '}') {
+        push(i, true);
+        args++;
+        start = ++i + 1;
+      } else if (c == '{' || c == '}') {
+        log_format_error("stray brace in the format, write {{ or }}");
+      }
+    }
+    if (i > start) {
+      push(i, false);
+    }
+    if (args != sizeof...(Args)) {
+      log_format_error("the number of {} in the format isn't the number of arguments");
+    }
   }
+};
+
+// the checked way, for when the buffer might not have room for everything
+template <typename T>
+void log_buffer_put(LogBuffer *buffer, T v) {
+  char text[LOG_FLOAT_CHARS];
+  log_buffer_append(buffer, text, log_put(text, v) - text);
 }
 
-#endif
\ No newline at end of file
+inline void log_buffer_put(LogBuffer *buffer, const char *s) {
+  log_buffer_append(buffer, s, __builtin_strlen(s));
+}
+
+// runs are a few words long, copied a word at a time rather than through a memcpy call each
+inline char *log_put_run(char *at, const char *s, u32 n) {
+  for (; n >= 8; n -= 8, at += 8, s += 8) {
+    __builtin_memcpy(at, s, 8);
+  }
+  for (; n != 0; --n) {
+    *at++ = *s++;
+  }
+  return at;
+}
+
+template <typename... Args>
+void tsprintf(LogBuffer *buffer, LogFormat<typename LogIdentity<Args>::Type...> format, Args... args) {
+  u32 run = 0;
+  // the most it can come to is checked once, then everything is written straight into the buffer
+  usize most = format.text_length + (log_put_size(args) + ... + 0);
+  if (most <= buffer->capacity - buffer->length) {
+    char *at = buffer->data + buffer->length;
+    auto put_run = [&]() {
+      LogRun r = format.runs[run++];
+      at = log_put_run(at, format.format + r.start, r.length);
+      return r.arg;
+    };
+    ([&]() {
+      while (!put_run()) {}
+      at = log_put(at, args);
+    }(), ...);
+    while (run < format.run_count) {
+      put_run();
+    }
+    buffer->length = at - buffer->data;
+    return;
+  }
+
+  auto put_run = [&]() {
+    LogRun r = format.runs[run++];
+    log_buffer_append(buffer, format.format + r.start, r.length);
+    return r.arg;
+  };
+  ([&]() {
+    while (!put_run()) {}
+    log_buffer_put(buffer, args);
+  }(), ...);
+  while (run < format.run_count) {
+    put_run();
+  }
+}
+
+/* tprintf("x = {}\n", x) logs each finished line as an info entry, a line without its '\n' yet waits in
+ * log_lines for the rest */
+#define LOG_LINE_SIZE (1 << 11)
+extern LogBuffer log_lines;
+
+void log_lines_send();
+
+template <typename... Args>
+void tprintf(LogFormat<typename LogIdentity<Args>::Type...> format, Args... args) {
+  tsprintf<Args...>(&log_lines, format, args...);
+  log_lines_send();
+}
+
+/* leveled logging. LOG_WARN(Chunk, "format", args...) formats like tprintf and puts the entry on a ring,
+ * which log_flush_frame hands to the host in one console_log_batch call at the end of the frame.
+ * levels below LOG_MIN_LEVEL (-DLOG_MIN_LEVEL=LogLevel_Warn) are compiled out, their formats are still
+ * checked but nothing runs, arguments included */
+enum LogLevel {
+  LogLevel_Debug,
+  LogLevel_Info,
+  LogLevel_Warn,
+  LogLevel_Error,
+  LogLevel_COUNT
+};
+
+#define LOG_CATEGORIES(X) X(General) X(Geo) X(Mesh) X(World) X(Chunk) X(Save)
+
+enum LogCategory {
+#define LOG_CATEGORY_ENUM(name) LogCategory_##name,
+  LOG_CATEGORIES(LOG_CATEGORY_ENUM)
+#undef LOG_CATEGORY_ENUM
+  LogCategory_COUNT
+};
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LogLevel_Debug
+#endif
+
+/* entries are "W Chunk: text\0", the level's letter then the category. one producer, the game, and one
+ * consumer, log_flush_frame; the indexes run freely and only the producer moves write. an entry that
+ * doesn't fit is dropped and counted */
+#define LOG_RING_SIZE (1 << 14)
+
+struct LogRing {
+  u32 read, write;
+  u32 dropped; // entries lost to a full ring or cut short by a full LogBuffer, since the last flush
+  char data[LOG_RING_SIZE];
+};
+
+extern LogRing log_ring;
+
+void log_push(LogLevel level, LogCategory category, const char *text, usize length);
+void log_flush_frame();
+
+#define LOG_ENTRY_SIZE 512 // longer entries are cut short
+
+template <typename... Args>
+void log_write(LogLevel level, LogCategory category, LogFormat<typename LogIdentity<Args>::Type...> format,
+               Args... args) {
+  char text[LOG_ENTRY_SIZE];
+  LogBuffer buffer = {text, 0, LOG_ENTRY_SIZE - 1};
+  tsprintf<Args...>(&buffer, format, args...);
+  log_push(level, category, text, buffer.length);
+}
+
+#define LOG(level, category, ...) do { \
+    if constexpr ((level) >= LOG_MIN_LEVEL) { \
+      log_write((level), (category), __VA_ARGS__); \
+    } \
+  } while (0)
+#define LOG_DEBUG(category, ...) LOG(LogLevel_Debug, LogCategory_##category, __VA_ARGS__)
+#define LOG_INFO(category, ...) LOG(LogLevel_Info, LogCategory_##category, __VA_ARGS__)
+#define LOG_WARN(category, ...) LOG(LogLevel_Warn, LogCategory_##category, __VA_ARGS__)
+#define LOG_ERROR(category, ...) LOG(LogLevel_Error, LogCategory_##category, __VA_ARGS__)
+
+#endif
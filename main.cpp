@@ -2,6 +2,10 @@
 #include "math.h"
 #include "gen.h"
 #include "log.h"
+#include "save.h"
+#include "record.h"
+#include "profile.h"
+#include "input.h"
 
 Vert cube_vertices[] = {
   // pos                normal    value
@@ -119,14 +123,26 @@ ItemStack *inv_hand(Inventory *inv) {
 }
 
 struct Camera {
-  Vec3 rotation; // don't use the z component (just don't)
+  Vec3 rotation; // don't use the z component (just don't). set with cam_set_rotation
   Vec3 position;
   float fov;
   float aspect;
+
+  // from rotation, so the trig is done once per change instead of on every use
+  Mat4 rotate; // yaw then pitch
+  Mat4 yaw;    // just the turn around y, for walking
+  Vec3 forward;
 };
 
+void cam_set_rotation(Camera *cam, Vec3 rotation) {
+  cam->rotation = rotation;
+  cam->rotate = m4_rotate_yxz({rotation.x, rotation.y, 0});
+  cam->yaw = m4_rotate_y(rotation.y);
+  cam->forward = m4_mul_dir(cam->rotate, {0, 0, 1});
+}
+
 Vec3 move_relative_to_camera(Camera *cam, Vec3 by) {
-  return m4_rotate_y(cam->rotation.y) * m4_rotate_x(cam->rotation.x) * by;
+  return m4_mul_dir(cam->rotate, by);
 }
 
 Vec3 get_infront_of_camera(Camera *cam, float by) {
@@ -134,30 +150,96 @@ Vec3 get_infront_of_camera(Camera *cam, float by) {
 }
 
 Vec3 cam_make_motion_relative(Camera *cam, Vec3 motion) {
-  return m4_rotate_y(cam->rotation.y) * motion;
+  return m4_mul_dir(cam->yaw, motion);
 }
 
 void cam_move(Camera *cam, Vec3 rotation_delta, Vec3 position_delta) {
   const float LIM = MATH_PI_2-0.001;
 
-  cam->rotation += rotation_delta;
+  Vec3 rotation = cam->rotation + rotation_delta;
+  rotation.x = fmod(rotation.x, MATH_PI*2);
+  rotation.y = fmod(rotation.y, MATH_PI*2);
+
+  if (rotation.x > LIM) {
+    rotation.x = LIM;
+  } else if (rotation.x < -LIM) {
+    rotation.x = -LIM;
+  }
+  cam_set_rotation(cam, rotation);
   cam->position += cam_make_motion_relative(cam, position_delta);
+}
+
+Mat4 cam_vp(Camera *cam) {
+  return m4_perspective(cam->fov, cam->aspect, 0.1, 1000.0) * m4_lookat(cam->position, cam->position+cam->forward, {0, 1, 0});
+}
+
+// planes of the view volume as a*x + b*y + c*z + d >= 0 inside, one plane per lane
+// so four spheres can be tested against each plane at once
+struct Frustum {
+  float a[6], b[6], c[6], d[6];
+};
 
-  cam->rotation.x = fmod(cam->rotation.x, MATH_PI*2);
-  cam->rotation.y = fmod(cam->rotation.y, MATH_PI*2);
+// Gribb/Hartmann: each plane is the w row of the view projection plus or minus another row.
+// uses the GL -w..w depth range, which is what WebGL clips to
+Frustum frustum_from_vp(Mat4 vp) {
+  auto row = [&vp](int i) {
+    return Vec3{vp.num[0][i], vp.num[1][i], vp.num[2][i]};
+  };
 
-  if (cam->rotation.x > LIM) {
-    cam->rotation.x = LIM;
-  } else if (cam->rotation.x < -LIM) {
-    cam->rotation.x = -LIM;
+  Frustum ret;
+  for (int i = 0; i < 6; ++i) {
+    int axis = i / 2;
+    float sign = i % 2 ? -1.0f : 1.0f;
+    Vec3 n = row(3) + row(axis) * sign;
+    float d = vp.num[3][3] + vp.num[3][axis] * sign;
+
+    // normalized so that sphere radii can be compared against the distances
+    float length = v3_length(n);
+    ret.a[i] = n.x / length;
+    ret.b[i] = n.y / length;
+    ret.c[i] = n.z / length;
+    ret.d[i] = d / length;
   }
+  return ret;
 }
 
-Mat4 cam_vp(Camera *cam) {
-  Vec3 eye = m4_rotate_y(cam->rotation.y) *
-             m4_rotate_x(cam->rotation.x) *
-             Vec3{0, 0, 1};
-  return m4_perspective(cam->fov, cam->aspect, 0.1, 1000.0) * m4_lookat(cam->position, cam->position+eye, {0, 1, 0});
+// sets visible[i] for every sphere that is at least partly inside, returns how many are.
+// goes 4 spheres at a time over the arrays
+u32 frustum_cull_spheres(Frustum *frustum, const float *x, const float *y, const float *z, const float *r,
+                         u32 count, bool *visible) {
+  u32 visible_count = 0;
+  u32 i = 0;
+
+  for (; i + 4 <= count; i += 4) {
+    f32x4 sx = f32x4_load(x + i), sy = f32x4_load(y + i), sz = f32x4_load(z + i);
+    f32x4 neg_r = -f32x4_load(r + i);
+    i32x4 inside = ~i32x4{};
+
+    for (int p = 0; p < 6; ++p) {
+      f32x4 distance = f32x4_splat(frustum->a[p]) * sx + f32x4_splat(frustum->b[p]) * sy +
+                       f32x4_splat(frustum->c[p]) * sz + f32x4_splat(frustum->d[p]);
+      inside &= distance >= neg_r;
+    }
+
+    for (u32 lane = 0; lane < 4; ++lane) {
+      visible[i + lane] = inside[lane] != 0;
+      visible_count += inside[lane] != 0;
+    }
+  }
+
+  for (; i < count; ++i) {
+    visible[i] = true;
+    for (int p = 0; p < 6; ++p) {
+      float distance = frustum->a[p] * x[i] + frustum->b[p] * y[i] + frustum->c[p] * z[i] + frustum->d[p];
+      if (distance < -r[i]) {
+        visible[i] = false;
+        break;
+      }
+    }
+    visible_count += visible[i];
+  }
+
+  return visible_count;
 }
 
 struct Ray {
@@ -170,16 +252,33 @@ struct Box {
   Vec3 max;
 };
 
+// box lives in local space, transform takes world space points into it
 struct TransformBox {
   Box box;
   Mat4 transform;
 };
 
-enum Key {
-  Key_Shift, Key_Space,
-  Key_W, Key_A, Key_S, Key_D,
-  Key_COUNT
+struct RayHit {
+  float t; // distance along the ray, in units of ray.direction
+  Vec3 normal;
+};
+
+// what keys do, see bindings_default
+enum Action {
+  Action_None,
+  Action_Forward, Action_Back, Action_Left, Action_Right, Action_Up, Action_Down,
+  Action_Slot1, Action_Slot2,
+  Action_ToggleProfile,
+  Action_COUNT
+};
+
+const char *action_names[] = {
+  "None",
+  "Forward", "Back", "Left", "Right", "Up", "Down",
+  "Slot1", "Slot2",
+  "ToggleProfile",
 };
+static_assert(sizeof action_names / sizeof action_names[0] == Action_COUNT, "action without a name");
 
 enum Shape {
   Shape_Cube,
@@ -191,14 +290,188 @@ struct Object {
   Shape shape;
   Item drop;
   Vec3 pos, rot, scale;
-  bool exists;
   bool unbreakable;
 };
 
+// refers to an object across growth and compaction, where an Object* would dangle.
+// removing the object bumps its slot's generation, so old handles stop resolving
+struct ObjectHandle {
+  u32 slot;
+  u32 generation;
+};
+
+#define OBJ_SLOT_NULL 0xffffffffu
+#define OBJ_HANDLE_NULL (ObjectHandle{OBJ_SLOT_NULL, 0})
+
+struct GridCell {
+  i32 x, y, z;
+};
+
+struct ObjectSlot {
+  u32 generation;
+  u32 dense;     // index into World::objects while alive, next free slot while on the free list
+  u32 bvh_leaf;
+  u32 grid_next; // slot + 1 of the next object in the same grid bucket, 0 at the end
+  GridCell grid_cell;
+};
+
+// spatial hash over object positions, so lookups only visit nearby cells
+struct Grid {
+#define GRID_CELL_SIZE 4.0f
+#define GRID_MIN_BUCKETS (1 << 10)
+  u32 *heads; // slot + 1, 0 when the bucket is empty
+  usize bucket_count; // power of two, doubled to stay above the object count
+};
+
+#define BVH_NULL 0xffffffffu
+
+struct BvhNode {
+  Box box;
+  u32 parent;
+  u32 left, right; // BVH_NULL for leaves
+  u32 item;        // what the leaf refers to, or the next free node while on the free list
+  i32 height;      // 0 for leaves
+};
+
+// dynamic bounding volume tree, grows its node storage as needed
+struct Bvh {
+  BvhNode *nodes;
+  usize capacity;
+  u32 root;
+  u32 free_list;
+};
+
+// world geometry is baked per region into instance buffers the host keeps around (see instances_upload),
+// so a frame only redoes the regions that were edited since the last one
+struct MeshRegion {
+#define MESH_REGION_SIZE 8.0f
+  GridCell cell;
+  bool live; // false while on the free list
+  bool dirty;
+  int instance_count[Shape_COUNT];
+  u32 next_free; // region index + 1, 0 at the end of the free list
+};
+
+// the instance buffer of `shape` in region `index`
+#define MESH_REGION_INSTANCES_ID(index, shape) (int(index) * Shape_COUNT + (shape))
+
+struct MeshRegions {
+  MeshRegion *regions; // indexes are stable and double as ids, regions that bake empty get reused
+  usize count, capacity;
+  u32 free_list; // region index + 1, 0 when empty
+  u32 *table; // open addressing on the cell, region index + 1, 0 when empty
+  usize table_size; // power of two, kept at least twice count
+  u32 *dirty; // indexes of regions waiting to be baked
+  usize dirty_count, dirty_capacity;
+
+  // bounding sphere of everything baked into each region, split up for frustum_cull_spheres
+  float *sphere_x, *sphere_y, *sphere_z, *sphere_r;
+  bool *visible; // per region, from the last render_mesh_regions
+  u32 object_count, culled_count; // from the last render_mesh_regions
+};
+
+// matrices derived from pos, rot and scale, only rebuilt when one of those changes
+struct ObjectTransform {
+  Mat4 model;   // local to world
+  Mat4 inverse; // world to local, for picking and collision
+  Mat4 normal;  // inverse transpose of model, for normals
+};
+
 struct World {
-#define OBJ_MAX 1024
-  Object objects[OBJ_MAX];
-  usize object_count;
+  // only live objects, packed at the front, with one array per field so loops only pull in what they use.
+  // removal moves the last object into the hole. index with the same i across all of them
+  float *pos_x, *pos_y, *pos_z;
+  Vec3 *rot, *scale;
+  Shape *shape;
+  Item *drop;
+  bool *unbreakable;
+  ObjectTransform *transforms;
+  bool *transform_dirty; // set when pos, rot or scale changed since transforms was built
+  u32 *object_slots; // slot of each object
+  usize object_count, object_capacity;
+
+  // handles point here, slots never move
+  ObjectSlot *slots;
+  usize slot_count, slot_capacity;
+  u32 free_slot;
+
+  Grid grid;
+  Bvh bvh;
+  MeshRegions meshes;
+};
+
+// the world is streamed in CHUNK_SIZE columns around the camera. chunks in range are kept in the world,
+// the rest are rebuilt from the save when they come back in range (see chunk_loaded).
+// NOTE: objects placed in a chunk nobody asked for yet stay in the world until it's loaded and unloaded once
+enum ChunkState {
+  ChunkState_Loading, // asked the host for it, waiting on chunk_loaded
+  ChunkState_Resident,
+};
+
+struct Chunk {
+  i32 x, z;
+  ChunkState state;
+};
+
+struct ChunkStream {
+#define CHUNK_SIZE 32.0f
+#define CHUNK_LOAD_RADIUS 2   // in chunks, a square around the camera's chunk
+#define CHUNK_UNLOAD_RADIUS 3 // past the load radius, so walking along an edge doesn't thrash
+#define CHUNK_OPS_PER_FRAME 2 // loads plus unloads started in one frame
+  Chunk *chunks; // tracked chunks, loading or resident
+  usize count, capacity;
+
+  // reused between unloads and loads
+  u32 *slots;
+  usize slot_capacity;
+  u8 *bytes;
+  usize byte_capacity;
+};
+
+// a chunk's edits in the log, chained through SaveLog::next
+struct SaveLogChunk {
+#define SAVE_EDIT_END 0xffffffffu
+  i32 x, z;
+  u32 first, last;
+};
+
+// every edit made to the world since the save's snapshot, in order. a loading chunk gets its snapshot
+// objects from the host and then replays its edits, so unloading never has to write anything.
+// edits from `flushed` on haven't been sent to the host yet, autosave does that every SAVE_INTERVAL seconds,
+// and once there are SAVE_COMPACT_EDITS it bakes them into a new snapshot and starts the log over
+struct SaveLog {
+#define SAVE_INTERVAL 5.0f
+#define SAVE_COMPACT_EDITS 4096
+  SaveEdit *edits;
+  usize count, capacity;
+  usize flushed;
+  u32 *next; // the next edit in the same chunk, SAVE_EDIT_END after its last one
+  usize next_capacity;
+  SaveLogChunk *chunks; // the chunks with edits, sorted by x then z like the snapshot's
+  usize chunk_count, chunk_capacity;
+  SaveInventory inventory; // as of the last inventory edit
+  float since_flush;
+  // the host's save couldn't be read. it's left as it is for the player to move aside or fix: nothing goes
+  // to it and its chunks aren't loaded, this session plays a new world that isn't kept
+  bool detached;
+};
+
+// events waiting to go out through record_append, sent at the end of every frame
+struct Recorder {
+#define RECORD_BUFFER_SIZE 256
+  bool recording;
+  RecordEvent events[RECORD_BUFFER_SIZE];
+  usize count;
+};
+
+/* the simulation runs in fixed steps of SIM_STEP whatever the frame rate is. frames draw the camera
+ * between the last two steps, `alpha` of the way from `prev` to `now` */
+struct SimClock {
+#define SIM_STEP (1.0f / 120.0f)
+#define SIM_MAX_STEPS 8 // per frame, a longer frame lets the simulation fall behind instead of catching up
+  float accumulator;
+  float alpha;
+  Vec3 prev, now; // camera position
 };
 
 struct State {
@@ -208,15 +481,22 @@ struct State {
   Camera cam;
 
   /* input */
-  bool keys[Key_COUNT];
+  Action bindings[Scancode_COUNT];
+  bool down[Scancode_COUNT];
+  u8 held[Action_COUNT]; // how many of the keys bound to it are down
+  bool show_profile;
   float time;
+  Recorder recorder;
 
   /* sim */
+  SimClock sim;
   bool is_placing_floor;
   Object placing_obj;
-  Object *facing_obj; 
+  ObjectHandle facing_obj;
 
   World world;
+  ChunkStream chunks;
+  SaveLog save;
   Inventory inventory;
 } *state;
 
@@ -245,17 +525,258 @@ Object default_obj(Shape shape) {
   return result;
 }
 
-void place_world_obj(World *world, Object obj) {
-  if (world->object_count >= OBJ_MAX) {
-    tprintf("Too many obj on screen, can't put\n");
+// moves `*items` into a new block of `new_capacity`, keeping the first `count`
+template <typename T>
+bool mem_resize(T **items, usize count, usize old_capacity, usize new_capacity) {
+  T *resized = (T *)mem_alloc(new_capacity * sizeof(T));
+  if (resized == nullptr) {
+    return false;
+  }
+
+  if (*items != nullptr) {
+    __builtin_memcpy(resized, *items, count * sizeof(T));
+    mem_free(*items, old_capacity * sizeof(T));
+  }
+  *items = resized;
+  return true;
+}
+
+usize grow_capacity(usize capacity, usize needed) {
+  if (capacity == 0) {
+    capacity = 64;
+  }
+  while (capacity < needed) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+Vec3 world_pos(World *world, u32 index) {
+  return {world->pos_x[index], world->pos_y[index], world->pos_z[index]};
+}
+
+// gathers the object at packed `index` out of the field arrays
+Object world_obj(World *world, u32 index) {
+  Object obj;
+  obj.shape = world->shape[index];
+  obj.drop = world->drop[index];
+  obj.pos = world_pos(world, index);
+  obj.rot = world->rot[index];
+  obj.scale = world->scale[index];
+  obj.unbreakable = world->unbreakable[index];
+  return obj;
+}
+
+void world_set(World *world, u32 index, Object obj) {
+  world->shape[index] = obj.shape;
+  world->drop[index] = obj.drop;
+  world->pos_x[index] = obj.pos.x;
+  world->pos_y[index] = obj.pos.y;
+  world->pos_z[index] = obj.pos.z;
+  world->rot[index] = obj.rot;
+  world->scale[index] = obj.scale;
+  world->unbreakable[index] = obj.unbreakable;
+  world->transform_dirty[index] = true;
+}
+
+// copies everything about the object at `from` over the one at `to`, cached matrices included
+void world_move(World *world, u32 to, u32 from) {
+  world_set(world, to, world_obj(world, from));
+  world->transforms[to] = world->transforms[from];
+  world->transform_dirty[to] = world->transform_dirty[from];
+  world->object_slots[to] = world->object_slots[from];
+}
+
+u32 world_slot_index(World *world, u32 slot) {
+  return world->slots[slot].dense;
+}
+
+// packed index of the object, -1 once it's gone. only good until the next place or remove
+i32 world_find(World *world, ObjectHandle handle) {
+  if (handle.slot >= world->slot_count || world->slots[handle.slot].generation != handle.generation) {
+    return -1;
+  }
+  return i32(world_slot_index(world, handle.slot));
+}
+
+// writes the packed index of every object in [first, last) within `radius` of `center` to `out`,
+// returns how many. goes 4 objects at a time over the position arrays
+u32 world_query_radius(World *world, u32 first, u32 last, Vec3 center, float radius, u32 *out, u32 max) {
+  f32x4 cx = f32x4_splat(center.x), cy = f32x4_splat(center.y), cz = f32x4_splat(center.z);
+  f32x4 r2 = f32x4_splat(radius * radius);
+  u32 found = 0;
+  u32 i = first;
+
+  for (; i + 4 <= last; i += 4) {
+    f32x4 dx = f32x4_load(world->pos_x + i) - cx;
+    f32x4 dy = f32x4_load(world->pos_y + i) - cy;
+    f32x4 dz = f32x4_load(world->pos_z + i) - cz;
+    i32x4 inside = (dx*dx + dy*dy + dz*dz) < r2;
+
+    if (i32x4_any(inside)) {
+      for (u32 lane = 0; lane < 4; ++lane) {
+        if (inside[lane] && found < max) {
+          out[found++] = i + lane;
+        }
+      }
+    }
+  }
+
+  for (; i < last; ++i) {
+    Vec3 d = world_pos(world, i) - center;
+    if (v3_dot(d, d) < radius * radius && found < max) {
+      out[found++] = i;
+    }
+  }
+
+  return found;
+}
+
+GridCell grid_cell(Vec3 pos) {
+  return {
+    i32(floor(pos.x / GRID_CELL_SIZE)),
+    i32(floor(pos.y / GRID_CELL_SIZE)),
+    i32(floor(pos.z / GRID_CELL_SIZE))
+  };
+}
+
+u32 grid_cell_hash(GridCell cell) {
+  return u32(cell.x) * 73856093u ^ u32(cell.y) * 19349663u ^ u32(cell.z) * 83492791u;
+}
+
+u32 grid_bucket(Grid *grid, GridCell cell) {
+  return grid_cell_hash(cell) & (grid->bucket_count - 1);
+}
+
+bool grid_cell_eq(GridCell a, GridCell b) {
+  return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+static void grid_link(World *world, u32 slot) {
+  Grid *grid = &world->grid;
+  ObjectSlot *entry = &world->slots[slot];
+  u32 bucket = grid_bucket(grid, entry->grid_cell);
+
+  entry->grid_next = grid->heads[bucket];
+  grid->heads[bucket] = slot + 1;
+}
+
+// relinks every live object into `bucket_count` buckets
+static bool grid_rehash(World *world, usize bucket_count) {
+  Grid *grid = &world->grid;
+  u32 *heads = (u32 *)mem_alloc(bucket_count * sizeof(u32));
+  if (heads == nullptr) {
+    return false;
+  }
+
+  mem_free(grid->heads, grid->bucket_count * sizeof(u32));
+  __builtin_memset(heads, 0, bucket_count * sizeof(u32));
+  grid->heads = heads;
+  grid->bucket_count = bucket_count;
+
+  for (usize i = 0; i < world->object_count; ++i) {
+    grid_link(world, world->object_slots[i]);
+  }
+  return true;
+}
+
+// expects the slot to already be live in the world
+void grid_insert(World *world, u32 slot, Vec3 pos) {
+  Grid *grid = &world->grid;
+  world->slots[slot].grid_cell = grid_cell(pos);
+
+  // keep around one object per bucket, rehashing links the new slot too
+  if (world->object_count > grid->bucket_count) {
+    usize bucket_count = grid->bucket_count ? grid->bucket_count * 2 : GRID_MIN_BUCKETS;
+    if (grid_rehash(world, bucket_count)) {
+      return;
+    }
+  }
+  // out of memory before there was ever a bucket, place_world_obj checks for this up front
+  if (grid->bucket_count == 0) {
+    return;
+  }
+  grid_link(world, slot);
+}
+
+void grid_remove(World *world, u32 slot) {
+  Grid *grid = &world->grid;
+  u32 *link = &grid->heads[grid_bucket(grid, world->slots[slot].grid_cell)];
+
+  while (*link != 0) {
+    if (*link == slot + 1) {
+      *link = world->slots[slot].grid_next;
+      world->slots[slot].grid_next = 0;
+      return;
+    }
+    link = &world->slots[*link - 1].grid_next;
+  }
+}
+
+// calls f(slot) for every object whose cell is within `radius` cells of `center` (a cube, not a sphere)
+template <typename F>
+void grid_visit_cells(World *world, GridCell center, i32 radius, F f) {
+  Grid *grid = &world->grid;
+  if (grid->bucket_count == 0) {
+    return;
+  }
+
+  for (i32 x = -radius; x <= radius; ++x) {
+    for (i32 y = -radius; y <= radius; ++y) {
+      for (i32 z = -radius; z <= radius; ++z) {
+        GridCell cell = {center.x + x, center.y + y, center.z + z};
+        // other cells can hash into the same bucket, so check we're actually in this one
+        for (u32 it = grid->heads[grid_bucket(grid, cell)]; it != 0; it = world->slots[it - 1].grid_next) {
+          if (grid_cell_eq(world->slots[it - 1].grid_cell, cell)) {
+            f(it - 1);
+          }
+        }
+      }
+    }
+  }
+}
+
+// calls f(slot) for every object that could be within `radius` of `pos`, caller does the exact test
+template <typename F>
+void grid_query_radius(World *world, Vec3 pos, float radius, F f) {
+  i32 cells = i32(radius / GRID_CELL_SIZE) + 1;
+  usize cell_count = usize(2*cells + 1) * usize(2*cells + 1) * usize(2*cells + 1);
+
+  // a vectorized scan is cheaper once there are more cells to visit than groups of 4 objects
+  if (cell_count * 4 > world->object_count) {
+    u32 found[256];
+    for (u32 first = 0; first < world->object_count; first += 256) {
+      u32 last = first + 256 < world->object_count ? first + 256 : world->object_count;
+      u32 count = world_query_radius(world, first, last, pos, radius, found, 256);
+      for (u32 i = 0; i < count; ++i) {
+        f(world->object_slots[found[i]]);
+      }
+    }
     return;
   }
-  obj.exists = true;
-  world->objects[world->object_count++] = obj;
+
+  grid_visit_cells(world, grid_cell(pos), cells, f);
 }
 
-bool is_object_valid(Object *object) {
-  return object != nullptr && object->exists;
+// packed index of the closest object to `pos` within `max_distance` that passes `filter`, -1 if none.
+// ties go to the lowest index, so it doesn't matter which way grid_query_radius went
+template <typename F>
+i32 grid_nearest(World *world, Vec3 pos, float max_distance, F filter) {
+  i32 closest = -1;
+  float closest_distance2 = max_distance * max_distance;
+
+  grid_query_radius(world, pos, max_distance, [&](u32 slot) {
+    u32 index = world_slot_index(world, slot);
+    Vec3 d = world_pos(world, index) - pos;
+    float distance2 = v3_dot(d, d);
+    if ((distance2 < closest_distance2 || (distance2 == closest_distance2 && i32(index) < closest)) &&
+        filter(index)) {
+      closest_distance2 = distance2;
+      closest = i32(index);
+    }
+  });
+
+  return closest;
 }
 
 struct Geo {
@@ -276,30 +797,34 @@ static void geo_make_tri(Geo *geo, u16 a, u16 b, u16 c) {
   geo->ibuf[geo->ibuf_len++] = c;
 }
 
-static void geo_push_geo(Geo *dst, Geo *src, float color, Mat4 m) {
+// `normal` (see m4_normal) transforms the normals along with m, nullptr leaves them as they are
+static void geo_push_geo(Geo *dst, const Geo *src, float color, Mat4 m, const Mat4 *normal = nullptr) {
   int v_start = dst->vbuf_len;
+  Vert *out = dst->vbuf + v_start;
+  transform_points(m, src->vbuf, out, src->vbuf_len);
   for (int i = 0; i < src->vbuf_len; i++) {
-    Vert vert = src->vbuf[i];
-    vert.norm = vert.norm;
-    vert.color = color;
-    vert.pos = m * vert.pos;
-    dst->vbuf[dst->vbuf_len++] = vert;
+    if (normal != nullptr) {
+      out[i].norm = v3_normalize(m4_mul_dir(*normal, out[i].norm));
+    }
+    out[i].color = color;
   }
+  dst->vbuf_len += src->vbuf_len;
 
   for (int i = 0; i < src->ibuf_len; i++) {
     dst->ibuf[dst->ibuf_len++] = v_start + src->ibuf[i];
   }
 }
 
-static void geo_fix_normals(Geo *dst, Mat4 m) {
-
-  for (int i = 0; i < dst->ibuf_len; i += 3) {
-    Vert *a = &dst->vbuf[dst->ibuf[i]],
-         *b = &dst->vbuf[dst->ibuf[i+1]],
-         *c = &dst->vbuf[dst->ibuf[i+2]];
-    Vec3 ap = a->pos * m,
-         bp = b->pos * m,
-         cp = c->pos * m;
+// flat normals from the winding of each triangle, in local space. shapes get these once at init
+// and are left alone after, draws transform them instead
+static void geo_compute_normals(Geo *geo) {
+  for (int i = 0; i < geo->ibuf_len; i += 3) {
+    Vert *a = &geo->vbuf[geo->ibuf[i]],
+         *b = &geo->vbuf[geo->ibuf[i+1]],
+         *c = &geo->vbuf[geo->ibuf[i+2]];
+    Vec3 ap = a->pos,
+         bp = b->pos,
+         cp = c->pos;
 
     Vec3 normal = v3_normalize(v3_cross(ap-cp, bp-cp));
     a->norm = b->norm = c->norm = normal;
@@ -335,6 +860,7 @@ Geo shape_geos[Shape_COUNT] = {
 };
 
 void flush_fgeo() {
+  PROFILE_ZONE("flush_fgeo");
   render(
     fgeo.ibuf, fgeo.ibuf_len,
     fgeo.vbuf, fgeo.vbuf_len,
@@ -351,31 +877,33 @@ void fgeo_set_vp(Mat4 vp) {
 }
 
 
-void render_geo(Geo *src, Mat4 m, float color) {
+void render_geo(const Geo *src, Mat4 m, float color, const Mat4 *normal = nullptr) {
+  PROFILE_ZONE("render_geo");
   if ((src->ibuf_len + fgeo.ibuf_len) >= FRAME_IBUF_SIZE) {
     flush_fgeo();
     if ((src->ibuf_len + fgeo.ibuf_len) >= FRAME_IBUF_SIZE) {
-      tprintf("Geo is too big to fit\n");
+      LOG_ERROR(Geo, "Geo is too big to fit");
       return;
     }
   }
   if ((src->vbuf_len + fgeo.vbuf_len) >= FRAME_VBUF_SIZE) {
     flush_fgeo();
     if ((src->vbuf_len + fgeo.vbuf_len) >= FRAME_VBUF_SIZE) {
-      tprintf("Geo is too big to fit\n");
+      LOG_ERROR(Geo, "Geo is too big to fit");
       return;
     }
   }
 
-  geo_push_geo(&fgeo, src, color, m);
+  geo_push_geo(&fgeo, src, color, m, normal);
 }
 
-void render_shape_colored(Shape shape, Mat4 m, float color) {
-  Geo *src = shape_geos + shape;
+// `normal` is the normal matrix of m, for when it's already around (see ObjectTransform)
+void render_shape_colored(Shape shape, Mat4 m, Mat4 normal, float color) {
+  render_geo(shape_geos + shape, m, color, &normal);
+}
 
-  // Reassign normals. NOTE: mutates original geo normals!
-  geo_fix_normals(src, m);
-  render_geo(src, m, color);
+void render_shape_colored(Shape shape, Mat4 m, float color) {
+  render_shape_colored(shape, m, m4_normal(m), color);
 }
 
 void render_shape_colored(Shape shape, Vec3 at, Vec3 rot, float color) {
@@ -418,7 +946,7 @@ void render_8x8_bitmap_3d(const u8 *bitmap, Mat4 m) {
       if (set) {
         for (int i = 0; i < 4; ++i) {
           Vert vertex = base[i];
-          vertex.pos += {float(x), float(-y), 0};
+          vertex.pos = vertex.pos + Vec3{float(x), float(-y), 0};
           out[i+out_count] = vertex;
         }
         for (int i = 0; i < 6; ++i) {
@@ -473,8 +1001,13 @@ void render_8x16ascii_text(const char *txt, int x, int y) {
   }
 }
 
-// NOTE: THIS IS A HACK!
-#define PUT_DEBUG_TEXT(x, y, args...) do {log_noflush = true; tprintf(args); log_noflush = false; render_8x16ascii_text(flush(), (x), (y));} while(0);
+// formatted into its own buffer on the stack, the log never sees it
+#define PUT_DEBUG_TEXT(x, y, args...) do { \
+    char debug_text[LOG_LINE_SIZE + 1]; \
+    LogBuffer debug_buffer = {debug_text, 0, LOG_LINE_SIZE}; \
+    tsprintf(&debug_buffer, args); \
+    render_8x16ascii_text(log_buffer_text(&debug_buffer), (x), (y)); \
+  } while (0)
 
 void render_debug_info(float dt) {
   Vec3 pos = state->cam.position;
@@ -483,6 +1016,7 @@ void render_debug_info(float dt) {
   PUT_DEBUG_TEXT(20, 20, 
     "- Debug Info\n"
     "\t> Object count: {}\n"
+    "\t> Culled objects: {}/{}\n"
     "\t- Camera\n"
     "\t\t> Position: ({}, {}, {})\n"
     "\t\t> Rotation: ({}, {})\n"
@@ -491,7 +1025,8 @@ void render_debug_info(float dt) {
     "\t> GeoVertices: {}\n"
     "\t> GeoFlushGen: {}\n", 
     int(state->world.object_count),
-    pos.x, pos.y, pos.z,
+    int(state->world.meshes.culled_count), int(state->world.meshes.object_count),
+    LogFixed{pos.x, 2}, LogFixed{pos.y, 2}, LogFixed{pos.z, 2},
     int(rot.x*(180/MATH_PI)), int(rot.y*(180/MATH_PI)),
     dt,
     int(fgeo.ibuf_len),
@@ -499,6 +1034,34 @@ void render_debug_info(float dt) {
     fgeo_flush_generation);
 }
 
+#ifdef PROFILE
+#define PROFILE_BAR_WIDTH 200.0f
+
+// the last finished frame's zones in the order they were entered, indented by depth, with a bar for the
+// share of the frame each one took
+void render_profile() {
+  ProfileFrame *frame = profile_last_frame();
+  if (frame == nullptr) {
+    return;
+  }
+  const u8 bar_bitmap[] = {
+    0b11111111, 0b11111111, 0b11111111, 0b11111111,
+    0b11111111, 0b11111111, 0b11111111, 0b11111111,
+  };
+
+  int x = state->window_w - 520;
+  int y = 20;
+  PUT_DEBUG_TEXT(x, y, "- Profile: {}us, {} dropped", int(frame->duration), int(frame->dropped));
+  for (u32 i = 0; i < frame->zone_count; ++i) {
+    ProfileZoneTime *zone = &frame->zones[i];
+    y += 16;
+    float share = frame->duration > 0 ? zone->total / frame->duration : 0;
+    render_8x8_bitmap(bar_bitmap, x, y + 2, share * PROFILE_BAR_WIDTH + 1, 12);
+    PUT_DEBUG_TEXT(x + PROFILE_BAR_WIDTH + 8 + zone->depth * 16, y, "{} {}us x{}", zone->name, int(zone->total), int(zone->calls));
+  }
+}
+#endif
+
 float object_distance(Object *a, Object *b) {
   return v3_length(a->pos - b->pos);
 }
@@ -511,24 +1074,36 @@ Mat4 object_model(Object *obj) {
   return m4_translate(obj->pos) * m4_scale(obj->scale) * m4_rotate_yxz(obj->rot);
 }
 
-Object *find_focus_obj(Vec3 to) {
-  Object *closest = nullptr;
-  float closest_distance = 1000000;
+// same model as object_model, the other two come from the same rotation so there's no extra trig
+ObjectTransform object_make_transform(Object *obj) {
+  Mat4 rotate = m4_rotate_yxz(obj->rot);
+  Mat4 inv_scale = m4_scale(Vec3{1, 1, 1} / obj->scale);
 
-  for (int i = 0; i < state->world.object_count; ++i) {
-    Object *obj = &state->world.objects[i];
-    // NOTE: checking if position is < 1.0f ensures that we don't place on top of trunks and other second layer objs
-    // This is probably a temporary hack.
-    if (obj->exists && obj->pos.y < 1.0f) { 
-      float distance = v3_length(state->world.objects[i].pos - to);
-      if (distance < 4 && distance < closest_distance)  {
-        closest_distance = distance;
-        closest = &state->world.objects[i];
-      }
-    }
+  ObjectTransform ret;
+  ret.model = m4_translate(obj->pos) * m4_scale(obj->scale) * rotate;
+  ret.inverse = m4_transpose(rotate) * inv_scale * m4_translate(obj->pos * -1);
+  ret.normal = inv_scale * rotate;
+  return ret;
+}
+
+// matrices of the object at packed `index`, rebuilt first if it moved
+ObjectTransform *world_transform(World *world, u32 index) {
+  if (world->transform_dirty[index]) {
+    Object obj = world_obj(world, index);
+    world->transforms[index] = object_make_transform(&obj);
+    world->transform_dirty[index] = false;
   }
+  return &world->transforms[index];
+}
 
-  return closest;
+// packed index of the object to build on from `to`, -1 if none
+i32 find_focus_obj(Vec3 to) {
+  World *world = &state->world;
+  // NOTE: checking if position is < 1.0f ensures that we don't place on top of trunks and other second layer objs
+  // This is probably a temporary hack.
+  return grid_nearest(world, to, 4, [world](u32 index) {
+    return world->pos_y[index] < 1.0f;
+  });
 }
 
 float normalize_angle(float angle) {
@@ -563,7 +1138,7 @@ Object make_aligned_object(Object *focus, Camera *cam) {
       break;
   }
 
-  result.pos = Vec3{0, 0, 1} * m4_rotate_y(rotation) + find_focus_obj(state->cam.position)->pos;
+  result.pos = Vec3{0, 0, 1} * m4_rotate_y(rotation) + focus->pos;
   result.rot.y = rotation;
   return result;
 }
@@ -595,111 +1170,1437 @@ bool point_vs_box(Vec3 pos, Box box) {
 }
 
 bool point_vs_transform_box(Vec3 pos, TransformBox tb) {
-  Vec3 origin = box_origin(tb.box);
-  Box centerBox = box_translate(tb.box, origin*-1);
+  return point_vs_box(tb.transform * pos, tb.box);
+}
 
-  Vec3 transformed = (origin - pos) * tb.transform;
-  return point_vs_box(transformed, centerBox);
+// turns a normal from the local space of `tb` back into world space
+static Vec3 transform_box_normal(TransformBox tb, Vec3 local_normal) {
+  return v3_normalize(m4_mul_dir(m4_transpose(tb.transform), local_normal));
 }
 
-bool ray_vs_box(Ray ray, TransformBox tb, Vec3 *collision) {
-  float delta = 0.01;
-  Vec3 pos = ray.origin;
-  Vec3 dir = v3_normalize(ray.direction) * delta;
-  Vec3 origin = box_origin(tb.box);
-  Box centerBox = box_translate(tb.box, origin*-1);
+// slab test, done in the local space of the box so it works for any rotation and scale
+bool ray_vs_box(Ray ray, TransformBox tb, RayHit *hit) {
+  Vec3 local_origin = tb.transform * ray.origin;
+  Vec3 local_dir = m4_mul_dir(tb.transform, ray.direction);
+  float o[3] = {local_origin.x, local_origin.y, local_origin.z};
+  float d[3] = {local_dir.x, local_dir.y, local_dir.z};
+  float lo[3] = {tb.box.min.x, tb.box.min.y, tb.box.min.z};
+  float hi[3] = {tb.box.max.x, tb.box.max.y, tb.box.max.z};
+
+  float t_near = -MATH_INF, t_far = MATH_INF;
+  int near_axis = -1;
+  float near_sign = 0;
+
+  for (int a = 0; a < 3; ++a) {
+    if (d[a] == 0) {
+      if (o[a] < lo[a] || o[a] > hi[a]) {
+        return false;
+      }
+      continue;
+    }
 
-  for (int i = 0; i < 100; ++i) {
-    pos += dir * i;
-    Vec3 transformed = (origin - pos) * tb.transform;
+    float inv = 1.0f / d[a];
+    float t0 = (lo[a] - o[a]) * inv;
+    float t1 = (hi[a] - o[a]) * inv;
+    float sign = -1;
+    if (t0 > t1) {
+      float tmp = t0; t0 = t1; t1 = tmp;
+      sign = 1;
+    }
 
-    if (point_vs_box(transformed, centerBox)) {
-      *collision = pos;
-      return true;
+    if (t0 > t_near) {
+      t_near = t0;
+      near_axis = a;
+      near_sign = sign;
+    }
+    if (t1 < t_far) {
+      t_far = t1;
+    }
+    if (t_near > t_far) {
+      return false;
     }
   }
-  *collision = pos;
-  return false;
-}
 
+  if (t_far < 0) {
+    return false;
+  }
+
+  if (t_near < 0 || near_axis < 0) {
+    // started inside the box
+    hit->t = 0;
+    hit->normal = v3_normalize(ray.direction) * -1;
+    return true;
+  }
 
-TransformBox object_make_transform_box(Object *obj) {
-  Mat4 tf = m4_rotate_yxz(obj->rot * -1) * m4_scale({1/obj->scale.x, 1/obj->scale.y, 1/obj->scale.z});
-  return {expand_box_from_point(obj->pos, 0.5), tf};
+  float n[3] = {0, 0, 0};
+  n[near_axis] = near_sign;
+  hit->t = t_near;
+  hit->normal = transform_box_normal(tb, {n[0], n[1], n[2]});
+  return true;
 }
 
-Ray cam_ray(Camera *cam) {
-  return {cam->position, m4_rotate_y(cam->rotation.y) * m4_rotate_x(cam->rotation.x) * Vec3{0, 0, 1}};
+// the cylinder is inscribed in tb.box, with its axis along local y
+bool ray_vs_cylinder(Ray ray, TransformBox tb, RayHit *hit) {
+  Vec3 center = box_origin(tb.box);
+  Vec3 half = (tb.box.max - tb.box.min) * 0.5f;
+
+  // scale so the cylinder becomes radius 1, height 2; t is unaffected by this
+  Vec3 o = (tb.transform * ray.origin - center) / half;
+  Vec3 d = m4_mul_dir(tb.transform, ray.direction) / half;
+
+  float side_near = -MATH_INF, side_far = MATH_INF;
+  float a = d.x*d.x + d.z*d.z;
+  float b = 2 * (o.x*d.x + o.z*d.z);
+  float c = o.x*o.x + o.z*o.z - 1;
+  if (a == 0) {
+    if (c > 0) {
+      return false;
+    }
+  } else {
+    float disc = b*b - 4*a*c;
+    if (disc < 0) {
+      return false;
+    }
+    float root = sqrt(disc);
+    side_near = (-b - root) / (2*a);
+    side_far = (-b + root) / (2*a);
+  }
+
+  float cap_near = -MATH_INF, cap_far = MATH_INF;
+  float cap_sign = 0;
+  if (d.y == 0) {
+    if (o.y < -1 || o.y > 1) {
+      return false;
+    }
+  } else {
+    cap_near = (-1 - o.y) / d.y;
+    cap_far = (1 - o.y) / d.y;
+    cap_sign = -1;
+    if (cap_near > cap_far) {
+      float tmp = cap_near; cap_near = cap_far; cap_far = tmp;
+      cap_sign = 1;
+    }
+  }
+
+  float t_near = side_near > cap_near ? side_near : cap_near;
+  float t_far = side_far < cap_far ? side_far : cap_far;
+  if (t_near > t_far || t_far < 0) {
+    return false;
+  }
+
+  if (t_near < 0) {
+    // started inside the cylinder
+    hit->t = 0;
+    hit->normal = v3_normalize(ray.direction) * -1;
+    return true;
+  }
+
+  Vec3 local_normal;
+  if (side_near > cap_near) {
+    Vec3 p = o + d * t_near;
+    local_normal = Vec3{p.x, 0, p.z} / half;
+  } else {
+    local_normal = {0, cap_sign, 0};
+  }
+
+  hit->t = t_near;
+  hit->normal = transform_box_normal(tb, local_normal);
+  return true;
 }
 
-Mat4 rect_vp_matrix(int x, int y, int w, int h) {
-  float aspect = float(state->window_w)/float(state->window_h);
-  x += w/2;
-  y += h/2;
-  float x_ = float(x) / state->window_w;
-  float y_ = float(y) / state->window_h;
-  x_ *= 2;
-  x_ -= 1;
-  y_ *= 2;
-  y_ -= 1;
-  static float n = 0.0;
-  return m4_translate({x_, -y_, 0}) * m4_isometric(state->window_w/w, state->window_h/h, 0.1, 1000.0) * m4_translate({0.0f, 0.0f, -100}); 
+TransformBox object_make_transform_box(ObjectTransform *transform) {
+  return {expand_box_from_point({0, 0, 0}, 0.5), transform->inverse};
 }
 
-void render_inventory(Inventory *inv) {
-  const u8 selected_bitmap[] = {
-    0b11111111,
-    0b11111111,
-    0b11111111,
-    0b11111111,
-    0b11111111,
-    0b11111111,
-    0b11111111,
-    0b11111111,
-  };
-  const u8 not_selected_bitmap[] = {
-    0b11111111,
-    0b10000001,
-    0b10000001,
-    0b10000001,
-    0b10000001,
-    0b10000001,
-    0b10000001,
-    0b11111111,
+// tb grown by a world space box with half size `half` around the origin, so sweeping that box's center as a
+// ray finds where the box would touch. exact for boxes lined up with the world axes, a bit wide at the
+// edges of rotated ones
+TransformBox transform_box_expand(TransformBox tb, Vec3 half) {
+  Mat4 m = tb.transform;
+  Vec3 extent = {
+    __builtin_fabsf(m.num[0][0])*half.x + __builtin_fabsf(m.num[1][0])*half.y + __builtin_fabsf(m.num[2][0])*half.z,
+    __builtin_fabsf(m.num[0][1])*half.x + __builtin_fabsf(m.num[1][1])*half.y + __builtin_fabsf(m.num[2][1])*half.z,
+    __builtin_fabsf(m.num[0][2])*half.x + __builtin_fabsf(m.num[1][2])*half.y + __builtin_fabsf(m.num[2][2])*half.z,
   };
+  tb.box.min -= extent;
+  tb.box.max += extent;
+  return tb;
+}
 
-  // FIXME: The depth test toggling here seems kinda bad
+bool ray_vs_object(Ray ray, Shape shape, ObjectTransform *transform, RayHit *hit) {
+  TransformBox tb = object_make_transform_box(transform);
 
-  for (int i = 0; i < INVENTORY_ITEM_COUNT; ++i) {
-    ItemStack slot = inv->items[i];
-    if (slot.item_type != Item_NULL) {
-      PUT_DEBUG_TEXT(20 + i * 80, state->window_h-32-32-16, "{} x{}", item_names[slot.item_type], int(slot.item_count));
-    }
-    int x = 20 + i * 80;
-    int y = state->window_h-32-32;
+  switch (shape) {
+    case Shape_Cylinder:
+      return ray_vs_cylinder(ray, tb, hit);
+    case Shape_Cube:
+    default:
+      return ray_vs_box(ray, tb, hit);
+  }
+}
 
-    fgeo_set_vp(m4_identity());
-    render_8x8_bitmap(inv->selection == i ? selected_bitmap : not_selected_bitmap, x, y, 64, 64);
+void bvh_init(Bvh *bvh) {
+  bvh->nodes = nullptr;
+  bvh->capacity = 0;
+  bvh->root = BVH_NULL;
+  bvh->free_list = BVH_NULL;
+}
 
-    // TODO: Figure out why different resolutions put objects further back
-    switch (slot.item_type) {
-      case Item_Leaves:
-        fgeo_set_vp(rect_vp_matrix(x, y, 64, 64));
-        render_shape_colored(Shape_Cylinder, m4_scale(0.5f) * m4_rotate_x(-1) * m4_rotate_y(state->time), 1.0f);
-        break;
-      case Item_Wood:
-        fgeo_set_vp(rect_vp_matrix(x, y, 64, 64));
-        render_shape_colored(Shape_Cube, m4_scale(0.5f) * m4_rotate_x(-1) * m4_rotate_y(state->time), 1.0f);
-        break;
-      default:;
-    }
-  }
-  fgeo_set_vp(m4_identity());
+Box box_union(Box a, Box b) {
+  return {
+    {a.min.x < b.min.x ? a.min.x : b.min.x, a.min.y < b.min.y ? a.min.y : b.min.y, a.min.z < b.min.z ? a.min.z : b.min.z},
+    {a.max.x > b.max.x ? a.max.x : b.max.x, a.max.y > b.max.y ? a.max.y : b.max.y, a.max.z > b.max.z ? a.max.z : b.max.z}
+  };
 }
 
-void render_overlays(float dt) {
-  fgeo_set_vp(m4_identity());
-  select(SelectKey_DepthTest, false);
+// half the surface area, which is all the insertion cost heuristic needs
+float box_cost(Box box) {
+  Vec3 d = box.max - box.min;
+  return d.x*d.y + d.y*d.z + d.z*d.x;
+}
+
+bool box_vs_box(Box a, Box b) {
+  return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+         a.min.y <= b.max.y && a.max.y >= b.min.y &&
+         a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+// world space bounds of `box` after transforming it by `m`
+Box box_transform(Box box, Mat4 m) {
+  Vec3 center = m * box_origin(box);
+  Vec3 half = (box.max - box.min) * 0.5f;
+  Vec3 extent = {
+    __builtin_fabsf(m.num[0][0])*half.x + __builtin_fabsf(m.num[1][0])*half.y + __builtin_fabsf(m.num[2][0])*half.z,
+    __builtin_fabsf(m.num[0][1])*half.x + __builtin_fabsf(m.num[1][1])*half.y + __builtin_fabsf(m.num[2][1])*half.z,
+    __builtin_fabsf(m.num[0][2])*half.x + __builtin_fabsf(m.num[1][2])*half.y + __builtin_fabsf(m.num[2][2])*half.z,
+  };
+  return {center - extent, center + extent};
+}
+
+// entry distance of the ray into the box, MATH_INF on a miss. inv_dir is 1/ray.direction
+float ray_vs_aabb(Vec3 origin, Vec3 inv_dir, Box box, float max_t) {
+  float tx0 = (box.min.x - origin.x) * inv_dir.x, tx1 = (box.max.x - origin.x) * inv_dir.x;
+  float ty0 = (box.min.y - origin.y) * inv_dir.y, ty1 = (box.max.y - origin.y) * inv_dir.y;
+  float tz0 = (box.min.z - origin.z) * inv_dir.z, tz1 = (box.max.z - origin.z) * inv_dir.z;
+
+  float t_near = __builtin_fmaxf(__builtin_fmaxf(__builtin_fminf(tx0, tx1), __builtin_fminf(ty0, ty1)), __builtin_fminf(tz0, tz1));
+  float t_far = __builtin_fminf(__builtin_fminf(__builtin_fmaxf(tx0, tx1), __builtin_fmaxf(ty0, ty1)), __builtin_fmaxf(tz0, tz1));
+
+  if (t_near > t_far || t_far < 0 || t_near > max_t) {
+    return MATH_INF;
+  }
+  return t_near;
+}
+
+// doubles the node storage and threads the new nodes onto the free list, lowest index first
+static bool bvh_grow(Bvh *bvh) {
+  usize capacity = grow_capacity(bvh->capacity, bvh->capacity + 1);
+  if (!mem_resize(&bvh->nodes, bvh->capacity, bvh->capacity, capacity)) {
+    return false;
+  }
+
+  for (usize i = capacity; i-- > bvh->capacity;) {
+    bvh->nodes[i].item = bvh->free_list;
+    bvh->nodes[i].height = -1;
+    bvh->free_list = i;
+  }
+  bvh->capacity = capacity;
+  return true;
+}
+
+static u32 bvh_alloc_node(Bvh *bvh) {
+  if (bvh->free_list == BVH_NULL && !bvh_grow(bvh)) {
+    return BVH_NULL;
+  }
+
+  u32 index = bvh->free_list;
+
+  BvhNode *node = &bvh->nodes[index];
+  bvh->free_list = node->item;
+  node->parent = node->left = node->right = BVH_NULL;
+  node->height = 0;
+  return index;
+}
+
+static void bvh_free_node(Bvh *bvh, u32 index) {
+  bvh->nodes[index].item = bvh->free_list;
+  bvh->nodes[index].height = -1;
+  bvh->free_list = index;
+}
+
+static bool bvh_is_leaf(BvhNode *node) {
+  return node->left == BVH_NULL;
+}
+
+static void bvh_replace_child(Bvh *bvh, u32 parent, u32 old_child, u32 new_child) {
+  if (parent == BVH_NULL) {
+    bvh->root = new_child;
+  } else if (bvh->nodes[parent].left == old_child) {
+    bvh->nodes[parent].left = new_child;
+  } else {
+    bvh->nodes[parent].right = new_child;
+  }
+}
+
+static void bvh_fix_node(Bvh *bvh, u32 index) {
+  BvhNode *node = &bvh->nodes[index];
+  BvhNode *left = &bvh->nodes[node->left];
+  BvhNode *right = &bvh->nodes[node->right];
+  node->box = box_union(left->box, right->box);
+  node->height = 1 + (left->height > right->height ? left->height : right->height);
+}
+
+// AVL style rotation: if one child of `a` is 2+ levels taller, lift it up. returns the new subtree root
+static u32 bvh_balance(Bvh *bvh, u32 ia) {
+  BvhNode *a = &bvh->nodes[ia];
+  if (bvh_is_leaf(a) || a->height < 2) {
+    return ia;
+  }
+
+  u32 ib = a->left, ic = a->right;
+  BvhNode *b = &bvh->nodes[ib], *c = &bvh->nodes[ic];
+  i32 balance = c->height - b->height;
+
+  // lift the taller child (`up`) above `a`, `a` keeps the other child and the shorter grandchild
+  u32 iup, ikeep;
+  if (balance > 1) {
+    iup = ic;
+    ikeep = ib;
+  } else if (balance < -1) {
+    iup = ib;
+    ikeep = ic;
+  } else {
+    return ia;
+  }
+
+  BvhNode *up = &bvh->nodes[iup];
+  u32 ix = up->left, iy = up->right;
+  if (bvh->nodes[ix].height < bvh->nodes[iy].height) {
+    u32 tmp = ix; ix = iy; iy = tmp;
+  }
+
+  // `x` is the taller grandchild, it stays under `up`. `y` moves down under `a`
+  up->parent = a->parent;
+  bvh_replace_child(bvh, a->parent, ia, iup);
+  up->left = ia;
+  up->right = ix;
+  a->parent = iup;
+  a->left = ikeep;
+  a->right = iy;
+  bvh->nodes[iy].parent = ia;
+
+  bvh_fix_node(bvh, ia);
+  bvh_fix_node(bvh, iup);
+  return iup;
+}
+
+// walk from `index` to the root, rebalancing and refitting every ancestor
+static void bvh_refit(Bvh *bvh, u32 index) {
+  while (index != BVH_NULL) {
+    index = bvh_balance(bvh, index);
+    bvh_fix_node(bvh, index);
+    index = bvh->nodes[index].parent;
+  }
+}
+
+// returns the leaf node for `item`, BVH_NULL when out of memory
+u32 bvh_insert(Bvh *bvh, Box box, u32 item) {
+  u32 leaf = bvh_alloc_node(bvh);
+  if (leaf == BVH_NULL) {
+    return BVH_NULL;
+  }
+  bvh->nodes[leaf].box = box;
+  bvh->nodes[leaf].item = item;
+
+  if (bvh->root == BVH_NULL) {
+    bvh->root = leaf;
+    return leaf;
+  }
+
+  // descend towards the sibling that grows the total surface area the least
+  u32 index = bvh->root;
+  while (!bvh_is_leaf(&bvh->nodes[index])) {
+    BvhNode *node = &bvh->nodes[index];
+    float area = box_cost(node->box);
+    float combined = box_cost(box_union(node->box, box));
+
+    // cost of making a new parent for this node and the leaf
+    float cost_here = 2 * combined;
+    // cost every level below pays for this node growing
+    float inherited = 2 * (combined - area);
+
+    float cost_child[2];
+    u32 children[2] = {node->left, node->right};
+    for (int i = 0; i < 2; ++i) {
+      BvhNode *child = &bvh->nodes[children[i]];
+      float grown = box_cost(box_union(child->box, box));
+      cost_child[i] = (bvh_is_leaf(child) ? grown : grown - box_cost(child->box)) + inherited;
+    }
+
+    if (cost_here < cost_child[0] && cost_here < cost_child[1]) {
+      break;
+    }
+    index = cost_child[0] < cost_child[1] ? children[0] : children[1];
+  }
+
+  u32 sibling = index;
+  u32 old_parent = bvh->nodes[sibling].parent;
+  u32 new_parent = bvh_alloc_node(bvh);
+  if (new_parent == BVH_NULL) {
+    bvh_free_node(bvh, leaf);
+    return BVH_NULL;
+  }
+
+  bvh->nodes[new_parent].parent = old_parent;
+  bvh->nodes[new_parent].left = sibling;
+  bvh->nodes[new_parent].right = leaf;
+  bvh->nodes[new_parent].item = BVH_NULL;
+  bvh->nodes[sibling].parent = new_parent;
+  bvh->nodes[leaf].parent = new_parent;
+  bvh_replace_child(bvh, old_parent, sibling, new_parent);
+
+  bvh_refit(bvh, new_parent);
+  return leaf;
+}
+
+void bvh_remove(Bvh *bvh, u32 leaf) {
+  if (leaf == bvh->root) {
+    bvh->root = BVH_NULL;
+    bvh_free_node(bvh, leaf);
+    return;
+  }
+
+  u32 parent = bvh->nodes[leaf].parent;
+  u32 grandparent = bvh->nodes[parent].parent;
+  u32 sibling = bvh->nodes[parent].left == leaf ? bvh->nodes[parent].right : bvh->nodes[parent].left;
+
+  // the sibling takes the parent's place
+  bvh_replace_child(bvh, grandparent, parent, sibling);
+  bvh->nodes[sibling].parent = grandparent;
+  bvh_free_node(bvh, parent);
+  bvh_free_node(bvh, leaf);
+
+  bvh_refit(bvh, grandparent);
+}
+
+// for when the item behind `leaf` moved. returns the (possibly different) leaf node
+u32 bvh_update(Bvh *bvh, u32 leaf, Box box) {
+  u32 item = bvh->nodes[leaf].item;
+  bvh_remove(bvh, leaf);
+  return bvh_insert(bvh, box, item);
+}
+
+#define BVH_STACK_SIZE 128
+
+// calls f(item) for every leaf whose box overlaps `box`
+template <typename F>
+void bvh_query_box(Bvh *bvh, Box box, F f) {
+  u32 stack[BVH_STACK_SIZE];
+  int top = 0;
+
+  if (bvh->root != BVH_NULL) {
+    stack[top++] = bvh->root;
+  }
+
+  while (top > 0) {
+    BvhNode *node = &bvh->nodes[stack[--top]];
+    if (!box_vs_box(node->box, box)) {
+      continue;
+    }
+
+    if (bvh_is_leaf(node)) {
+      f(node->item);
+    } else if (top + 2 <= BVH_STACK_SIZE) {
+      stack[top++] = node->left;
+      stack[top++] = node->right;
+    }
+  }
+}
+
+// calls f(item, max_t) for every leaf the ray enters before max_t, nearest subtree first.
+// f returns the new max_t, so each hit shrinks what is left to search
+template <typename F>
+void bvh_raycast(Bvh *bvh, Ray ray, float max_t, F f) {
+  Vec3 inv_dir = {1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z};
+  u32 stack[BVH_STACK_SIZE];
+  float stack_t[BVH_STACK_SIZE];
+  int top = 0;
+
+  if (bvh->root != BVH_NULL) {
+    float t = ray_vs_aabb(ray.origin, inv_dir, bvh->nodes[bvh->root].box, max_t);
+    if (t != MATH_INF) {
+      stack_t[top] = t;
+      stack[top++] = bvh->root;
+    }
+  }
+
+  while (top > 0) {
+    --top;
+    if (stack_t[top] > max_t) {
+      continue;
+    }
+
+    BvhNode *node = &bvh->nodes[stack[top]];
+    if (bvh_is_leaf(node)) {
+      max_t = f(node->item, max_t);
+      continue;
+    }
+
+    float t_left = ray_vs_aabb(ray.origin, inv_dir, bvh->nodes[node->left].box, max_t);
+    float t_right = ray_vs_aabb(ray.origin, inv_dir, bvh->nodes[node->right].box, max_t);
+    u32 near = node->left, far = node->right;
+    if (t_right < t_left) {
+      float tmp = t_left; t_left = t_right; t_right = tmp;
+      near = node->right;
+      far = node->left;
+    }
+
+    // push the far child first so the near one is popped next
+    if (t_right != MATH_INF && top < BVH_STACK_SIZE) {
+      stack_t[top] = t_right;
+      stack[top++] = far;
+    }
+    if (t_left != MATH_INF && top < BVH_STACK_SIZE) {
+      stack_t[top] = t_left;
+      stack[top++] = near;
+    }
+  }
+}
+
+Box object_bounds(ObjectTransform *transform) {
+  return box_transform(object_make_transform_box(transform).box, transform->model);
+}
+
+MeshRegion *mesh_region_find(MeshRegions *meshes, GridCell cell) {
+  if (meshes->table_size == 0) {
+    return nullptr;
+  }
+
+  for (usize i = grid_cell_hash(cell) & (meshes->table_size - 1); meshes->table[i] != 0; i = (i + 1) & (meshes->table_size - 1)) {
+    MeshRegion *region = &meshes->regions[meshes->table[i] - 1];
+    if (grid_cell_eq(region->cell, cell)) {
+      return region;
+    }
+  }
+  return nullptr;
+}
+
+static void mesh_region_link(MeshRegions *meshes, u32 index) {
+  usize i = grid_cell_hash(meshes->regions[index].cell) & (meshes->table_size - 1);
+  while (meshes->table[i] != 0) {
+    i = (i + 1) & (meshes->table_size - 1);
+  }
+  meshes->table[i] = index + 1;
+}
+
+// takes the region out of the table so that lookups past it still work
+static void mesh_region_unlink(MeshRegions *meshes, u32 index) {
+  usize mask = meshes->table_size - 1;
+  usize hole = grid_cell_hash(meshes->regions[index].cell) & mask;
+  while (meshes->table[hole] != index + 1) {
+    hole = (hole + 1) & mask;
+  }
+
+  // pull later entries of the same probe run back into the hole, unless that would put them before their hash
+  for (usize i = (hole + 1) & mask; meshes->table[i] != 0; i = (i + 1) & mask) {
+    usize home = grid_cell_hash(meshes->regions[meshes->table[i] - 1].cell) & mask;
+    bool movable = hole <= i ? (home <= hole || home > i) : (home <= hole && home > i);
+    if (movable) {
+      meshes->table[hole] = meshes->table[i];
+      hole = i;
+    }
+  }
+  meshes->table[hole] = 0;
+}
+
+static void mesh_region_free(MeshRegions *meshes, u32 index) {
+  mesh_region_unlink(meshes, index);
+  meshes->regions[index].live = false;
+  meshes->regions[index].next_free = meshes->free_list;
+  meshes->free_list = index + 1;
+}
+
+static MeshRegion *mesh_region_add(MeshRegions *meshes, GridCell cell) {
+  if (meshes->free_list != 0) {
+    u32 index = meshes->free_list - 1;
+    meshes->free_list = meshes->regions[index].next_free;
+    meshes->regions[index] = {cell, true, false, {}, 0};
+    mesh_region_link(meshes, index);
+    return &meshes->regions[index];
+  }
+
+  if (meshes->count >= meshes->capacity) {
+    usize count = meshes->count, old_capacity = meshes->capacity;
+    usize capacity = grow_capacity(old_capacity, count + 1);
+    auto resize = [&](auto **field) {
+      return mem_resize(field, count, old_capacity, capacity);
+    };
+
+    if (!resize(&meshes->regions) || !resize(&meshes->sphere_x) || !resize(&meshes->sphere_y) ||
+        !resize(&meshes->sphere_z) || !resize(&meshes->sphere_r) || !resize(&meshes->visible)) {
+      return nullptr;
+    }
+    meshes->capacity = capacity;
+  }
+
+  if ((meshes->count + 1) * 2 > meshes->table_size) {
+    usize table_size = meshes->table_size ? meshes->table_size * 2 : 64;
+    u32 *table = (u32 *)mem_alloc(table_size * sizeof(u32));
+    if (table == nullptr) {
+      return nullptr;
+    }
+
+    mem_free(meshes->table, meshes->table_size * sizeof(u32));
+    __builtin_memset(table, 0, table_size * sizeof(u32));
+    meshes->table = table;
+    meshes->table_size = table_size;
+    for (u32 i = 0; i < meshes->count; ++i) {
+      if (meshes->regions[i].live) {
+        mesh_region_link(meshes, i);
+      }
+    }
+  }
+
+  u32 index = meshes->count++;
+  meshes->regions[index] = {cell, true, false, {}, 0};
+  meshes->sphere_x[index] = meshes->sphere_y[index] = meshes->sphere_z[index] = meshes->sphere_r[index] = 0;
+  mesh_region_link(meshes, index);
+  return &meshes->regions[index];
+}
+
+GridCell mesh_region_cell(Vec3 pos) {
+  return {
+    i32(floor(pos.x / MESH_REGION_SIZE)),
+    i32(floor(pos.y / MESH_REGION_SIZE)),
+    i32(floor(pos.z / MESH_REGION_SIZE))
+  };
+}
+
+// queues the region holding `pos` for a rebake
+void mesh_region_touch(MeshRegions *meshes, Vec3 pos) {
+  GridCell cell = mesh_region_cell(pos);
+  MeshRegion *region = mesh_region_find(meshes, cell);
+  if (region == nullptr) {
+    region = mesh_region_add(meshes, cell);
+  }
+  if (region == nullptr || region->dirty) {
+    return;
+  }
+
+  if (meshes->dirty_count >= meshes->dirty_capacity) {
+    usize capacity = grow_capacity(meshes->dirty_capacity, meshes->dirty_count + 1);
+    if (!mem_resize(&meshes->dirty, meshes->dirty_count, meshes->dirty_capacity, capacity)) {
+      LOG_ERROR(Mesh, "Out of memory for mesh regions, can't rebake");
+      return;
+    }
+    meshes->dirty_capacity = capacity;
+  }
+
+  region->dirty = true;
+  meshes->dirty[meshes->dirty_count++] = u32(region - meshes->regions);
+}
+
+void world_init(World *world) {
+  world->free_slot = OBJ_SLOT_NULL;
+  bvh_init(&world->bvh);
+}
+
+static void mesh_regions_free(MeshRegions *meshes) {
+  usize capacity = meshes->capacity;
+  mem_free(meshes->regions, capacity * sizeof(MeshRegion));
+  mem_free(meshes->sphere_x, capacity * sizeof(float));
+  mem_free(meshes->sphere_y, capacity * sizeof(float));
+  mem_free(meshes->sphere_z, capacity * sizeof(float));
+  mem_free(meshes->sphere_r, capacity * sizeof(float));
+  mem_free(meshes->visible, capacity * sizeof(bool));
+  mem_free(meshes->table, meshes->table_size * sizeof(u32));
+  mem_free(meshes->dirty, meshes->dirty_capacity * sizeof(u32));
+  *meshes = {};
+}
+
+// gives back everything the world owns, world_init makes it usable again
+void world_free(World *world) {
+  usize capacity = world->object_capacity;
+  auto release = [&](auto *field) {
+    mem_free(field, capacity * sizeof(*field));
+  };
+  release(world->pos_x); release(world->pos_y); release(world->pos_z);
+  release(world->rot); release(world->scale); release(world->shape);
+  release(world->drop); release(world->unbreakable); release(world->transforms);
+  release(world->transform_dirty); release(world->object_slots);
+  mem_free(world->slots, world->slot_capacity * sizeof(ObjectSlot));
+  mem_free(world->grid.heads, world->grid.bucket_count * sizeof(u32));
+  mem_free(world->bvh.nodes, world->bvh.capacity * sizeof(BvhNode));
+  mesh_regions_free(&world->meshes);
+  *world = {};
+}
+
+static bool world_reserve(World *world, usize objects) {
+  if (objects > world->object_capacity) {
+    usize count = world->object_count, old_capacity = world->object_capacity;
+    usize capacity = grow_capacity(old_capacity, objects);
+    auto resize = [&](auto **field) {
+      return mem_resize(field, count, old_capacity, capacity);
+    };
+
+    // NOTE: a failure part way leaves some fields bigger than object_capacity, which is harmless
+    if (!resize(&world->pos_x) || !resize(&world->pos_y) || !resize(&world->pos_z) ||
+        !resize(&world->rot) || !resize(&world->scale) || !resize(&world->shape) ||
+        !resize(&world->drop) || !resize(&world->unbreakable) || !resize(&world->transforms) ||
+        !resize(&world->transform_dirty) || !resize(&world->object_slots)) {
+      return false;
+    }
+    world->object_capacity = capacity;
+  }
+
+  // a free slot gets reused, otherwise we need a new one
+  if (world->free_slot == OBJ_SLOT_NULL && world->slot_count >= world->slot_capacity) {
+    usize capacity = grow_capacity(world->slot_capacity, world->slot_count + 1);
+    if (!mem_resize(&world->slots, world->slot_count, world->slot_capacity, capacity)) {
+      return false;
+    }
+    world->slot_capacity = capacity;
+  }
+
+  return true;
+}
+
+ObjectHandle place_world_obj(World *world, Object obj) {
+  if (!world_reserve(world, world->object_count + 1)) {
+    LOG_ERROR(World, "Out of memory for objects, can't put");
+    return OBJ_HANDLE_NULL;
+  }
+  // the grid can't take the object without any buckets, get the first ones before anything changes
+  if (world->grid.bucket_count == 0 && !grid_rehash(world, GRID_MIN_BUCKETS)) {
+    LOG_ERROR(World, "Out of memory for the grid, can't put");
+    return OBJ_HANDLE_NULL;
+  }
+
+  u32 slot = world->free_slot;
+  if (slot != OBJ_SLOT_NULL) {
+    world->free_slot = world->slots[slot].dense;
+  } else {
+    slot = world->slot_count++;
+    world->slots[slot] = {};
+  }
+
+  u32 dense = world->object_count++;
+  world_set(world, dense, obj);
+  world->object_slots[dense] = slot;
+  world->slots[slot].dense = dense;
+
+  grid_insert(world, slot, obj.pos);
+  world->slots[slot].bvh_leaf = bvh_insert(&world->bvh, object_bounds(world_transform(world, dense)), slot);
+  mesh_region_touch(&world->meshes, obj.pos);
+
+  return {slot, world->slots[slot].generation};
+}
+
+void move_world_obj(World *world, ObjectHandle handle, Vec3 pos, Vec3 rot, Vec3 scale) {
+  i32 index = world_find(world, handle);
+  if (index < 0) {
+    return;
+  }
+
+  mesh_region_touch(&world->meshes, world_pos(world, index));
+  mesh_region_touch(&world->meshes, pos);
+
+  grid_remove(world, handle.slot);
+  world->pos_x[index] = pos.x;
+  world->pos_y[index] = pos.y;
+  world->pos_z[index] = pos.z;
+  world->rot[index] = rot;
+  world->scale[index] = scale;
+  world->transform_dirty[index] = true;
+  grid_insert(world, handle.slot, pos);
+
+  ObjectSlot *slot = &world->slots[handle.slot];
+  slot->bvh_leaf = bvh_update(&world->bvh, slot->bvh_leaf, object_bounds(world_transform(world, index)));
+}
+
+void remove_world_obj(World *world, ObjectHandle handle) {
+  if (world_find(world, handle) < 0) {
+    return;
+  }
+
+  ObjectSlot *slot = &world->slots[handle.slot];
+  mesh_region_touch(&world->meshes, world_pos(world, slot->dense));
+  grid_remove(world, handle.slot);
+  if (slot->bvh_leaf != BVH_NULL) {
+    bvh_remove(&world->bvh, slot->bvh_leaf);
+  }
+
+  // fill the hole with the last object
+  u32 dense = slot->dense;
+  u32 last = --world->object_count;
+  world_move(world, dense, last);
+  world->slots[world->object_slots[dense]].dense = dense;
+
+  slot->generation++;
+  slot->dense = world->free_slot;
+  world->free_slot = handle.slot;
+}
+
+i32 chunk_coord(float x) {
+  return i32(floor(x / CHUNK_SIZE));
+}
+
+// removes every object, keeping the memory for the next ones
+void world_clear(World *world) {
+  while (world->object_count > 0) {
+    u32 slot = world->object_slots[world->object_count - 1];
+    remove_world_obj(world, {slot, world->slots[slot].generation});
+  }
+}
+
+Chunk *chunk_find(ChunkStream *stream, i32 x, i32 z) {
+  for (usize i = 0; i < stream->count; ++i) {
+    if (stream->chunks[i].x == x && stream->chunks[i].z == z) {
+      return &stream->chunks[i];
+    }
+  }
+  return nullptr;
+}
+
+void chunk_stream_free(ChunkStream *stream) {
+  mem_free(stream->chunks, stream->capacity * sizeof(Chunk));
+  mem_free(stream->slots, stream->slot_capacity * sizeof(u32));
+  mem_free(stream->bytes, stream->byte_capacity);
+  *stream = {};
+}
+
+u8 *chunk_scratch_bytes(ChunkStream *stream, usize size) {
+  if (size > stream->byte_capacity) {
+    usize capacity = grow_capacity(stream->byte_capacity, size);
+    if (!mem_resize(&stream->bytes, 0, stream->byte_capacity, capacity)) {
+      return nullptr;
+    }
+    stream->byte_capacity = capacity;
+  }
+  return stream->bytes;
+}
+
+// takes every object in chunk x, z out of the world
+static bool chunk_clear(ChunkStream *stream, World *world, i32 x, i32 z) {
+  Box box = {
+    {x * CHUNK_SIZE, -MATH_INF, z * CHUNK_SIZE},
+    {(x + 1) * CHUNK_SIZE, MATH_INF, (z + 1) * CHUNK_SIZE},
+  };
+
+  // can't remove while walking the bvh, so collect first
+  usize count = 0;
+  bool out_of_memory = false;
+  bvh_query_box(&world->bvh, box, [&](u32 slot) {
+    Vec3 pos = world_pos(world, world_slot_index(world, slot));
+    // objects sticking in from a neighbour belong to the neighbour
+    if (chunk_coord(pos.x) != x || chunk_coord(pos.z) != z) {
+      return;
+    }
+
+    if (count >= stream->slot_capacity) {
+      usize capacity = grow_capacity(stream->slot_capacity, count + 1);
+      if (!mem_resize(&stream->slots, count, stream->slot_capacity, capacity)) {
+        out_of_memory = true;
+        return;
+      }
+      stream->slot_capacity = capacity;
+    }
+    stream->slots[count++] = slot;
+  });
+
+  if (out_of_memory) {
+    LOG_ERROR(Chunk, "Out of memory for chunks, can't clear");
+    return false;
+  }
+
+  for (usize i = 0; i < count; ++i) {
+    u32 slot = stream->slots[i];
+    remove_world_obj(world, {slot, world->slots[slot].generation});
+  }
+  return true;
+}
+
+// everything in it is in the save already, so this just drops the objects
+static bool chunk_unload(ChunkStream *stream, World *world, Chunk *chunk) {
+  if (!chunk_clear(stream, world, chunk->x, chunk->z)) {
+    return false;
+  }
+
+  // swap remove, chunk points at the last one after
+  *chunk = stream->chunks[--stream->count];
+  return true;
+}
+
+static bool chunk_request(ChunkStream *stream, i32 x, i32 z) {
+  if (stream->count >= stream->capacity) {
+    usize capacity = grow_capacity(stream->capacity, stream->count + 1);
+    if (!mem_resize(&stream->chunks, stream->count, stream->capacity, capacity)) {
+      LOG_ERROR(Chunk, "Out of memory for chunks, can't load");
+      return false;
+    }
+    stream->capacity = capacity;
+  }
+
+  // tracked before asking, the host is allowed to answer from inside chunk_load
+  stream->chunks[stream->count++] = {x, z, ChunkState_Loading};
+  chunk_load(x, z);
+  return true;
+}
+
+i32 chunk_distance(Chunk *chunk, i32 x, i32 z) {
+  i32 dx = chunk->x > x ? chunk->x - x : x - chunk->x;
+  i32 dz = chunk->z > z ? chunk->z - z : z - chunk->z;
+  return dx > dz ? dx : dz;
+}
+
+// unloads far chunks, farthest first, and asks for missing near ones, nearest first.
+// starts at most CHUNK_OPS_PER_FRAME of those so a frame never waits on a pile of them
+void stream_chunks(ChunkStream *stream, World *world, Vec3 center) {
+  PROFILE_ZONE("stream_chunks");
+  i32 cx = chunk_coord(center.x);
+  i32 cz = chunk_coord(center.z);
+  int ops = 0;
+
+  while (ops < CHUNK_OPS_PER_FRAME) {
+    Chunk *farthest = nullptr;
+    for (usize i = 0; i < stream->count; ++i) {
+      Chunk *chunk = &stream->chunks[i];
+      if (chunk->state == ChunkState_Resident && chunk_distance(chunk, cx, cz) > CHUNK_UNLOAD_RADIUS &&
+          (farthest == nullptr || chunk_distance(chunk, cx, cz) > chunk_distance(farthest, cx, cz))) {
+        farthest = chunk;
+      }
+    }
+    if (farthest == nullptr || !chunk_unload(stream, world, farthest)) {
+      break;
+    }
+    ops++;
+  }
+
+  for (i32 radius = 0; radius <= CHUNK_LOAD_RADIUS && ops < CHUNK_OPS_PER_FRAME; ++radius) {
+    for (i32 x = cx - radius; x <= cx + radius && ops < CHUNK_OPS_PER_FRAME; ++x) {
+      for (i32 z = cz - radius; z <= cz + radius && ops < CHUNK_OPS_PER_FRAME; ++z) {
+        bool on_ring = x == cx - radius || x == cx + radius || z == cz - radius || z == cz + radius;
+        if (on_ring && chunk_find(stream, x, z) == nullptr) {
+          if (!chunk_request(stream, x, z)) {
+            return;
+          }
+          ops++;
+        }
+      }
+    }
+  }
+}
+
+static_assert(INVENTORY_ITEM_COUNT == sizeof(SaveInventory::items) / sizeof(SaveInventory::items[0]),
+              "SaveInventory doesn't fit the inventory");
+
+SaveObject save_object(Object obj) {
+  SaveObject record = {
+    {obj.pos.x, obj.pos.y, obj.pos.z},
+    {obj.rot.x, obj.rot.y, obj.rot.z},
+    {obj.scale.x, obj.scale.y, obj.scale.z},
+    u8(obj.shape), u8(obj.drop), obj.unbreakable, 0,
+  };
+  return record;
+}
+
+Object save_object_load(const SaveObject *record) {
+  Object obj = {};
+  obj.shape = Shape(record->shape);
+  obj.drop = Item(record->drop);
+  obj.pos = {record->pos[0], record->pos[1], record->pos[2]};
+  obj.rot = {record->rot[0], record->rot[1], record->rot[2]};
+  obj.scale = {record->scale[0], record->scale[1], record->scale[2]};
+  obj.unbreakable = record->unbreakable != 0;
+  return obj;
+}
+
+bool save_object_eq(const SaveObject *a, const SaveObject *b) {
+  for (int i = 0; i < 3; ++i) {
+    if (a->pos[i] != b->pos[i] || a->rot[i] != b->rot[i] || a->scale[i] != b->scale[i]) {
+      return false;
+    }
+  }
+  return a->shape == b->shape && a->drop == b->drop && a->unbreakable == b->unbreakable;
+}
+
+SaveInventory save_inventory(Inventory *inv) {
+  SaveInventory record = {inv->selection, {}};
+  for (int i = 0; i < INVENTORY_ITEM_COUNT; ++i) {
+    record.items[i] = {u32(inv->items[i].item_type), inv->items[i].item_count};
+  }
+  return record;
+}
+
+Inventory save_inventory_load(const SaveInventory *record) {
+  Inventory inv = {};
+  inv.selection = record->selection < INVENTORY_ITEM_COUNT ? record->selection : 0;
+  for (int i = 0; i < INVENTORY_ITEM_COUNT; ++i) {
+    Item item = record->items[i].item_type < Item_COUNT ? Item(record->items[i].item_type) : Item_NULL;
+    inv.items[i] = {item, record->items[i].item_count};
+  }
+  return inv;
+}
+
+// where chunk x, z is or would go in log->chunks
+usize save_log_chunk_search(SaveLog *log, i32 x, i32 z) {
+  usize lo = 0, hi = log->chunk_count;
+  while (lo < hi) {
+    usize mid = lo + (hi - lo) / 2;
+    SaveLogChunk *chunk = &log->chunks[mid];
+    if (chunk->x < x || (chunk->x == x && chunk->z < z)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// nullptr if chunk x, z has no edits
+SaveLogChunk *save_log_chunk_find(SaveLog *log, i32 x, i32 z) {
+  usize at = save_log_chunk_search(log, x, z);
+  if (at < log->chunk_count && log->chunks[at].x == x && log->chunks[at].z == z) {
+    return &log->chunks[at];
+  }
+  return nullptr;
+}
+
+// chains the edit at `index` onto its chunk's, new chunks are rare enough to insert in place
+static bool save_log_index(SaveLog *log, u32 index) {
+  SaveEdit *edit = &log->edits[index];
+  log->next[index] = SAVE_EDIT_END;
+  if (edit->kind != SaveEdit_Place && edit->kind != SaveEdit_Remove) {
+    return true;
+  }
+
+  Object obj = save_object_load(&edit->object);
+  i32 x = chunk_coord(obj.pos.x), z = chunk_coord(obj.pos.z);
+  usize at = save_log_chunk_search(log, x, z);
+  if (at < log->chunk_count && log->chunks[at].x == x && log->chunks[at].z == z) {
+    log->next[log->chunks[at].last] = index;
+    log->chunks[at].last = index;
+    return true;
+  }
+
+  if (log->chunk_count >= log->chunk_capacity) {
+    usize capacity = grow_capacity(log->chunk_capacity, log->chunk_count + 1);
+    if (!mem_resize(&log->chunks, log->chunk_count, log->chunk_capacity, capacity)) {
+      return false;
+    }
+    log->chunk_capacity = capacity;
+  }
+  __builtin_memmove(&log->chunks[at + 1], &log->chunks[at], (log->chunk_count - at) * sizeof(SaveLogChunk));
+  log->chunks[at] = {x, z, index, index};
+  log->chunk_count++;
+  return true;
+}
+
+bool save_push(SaveLog *log, SaveEdit edit) {
+  if (log->count >= log->capacity) {
+    usize capacity = grow_capacity(log->capacity, log->count + 1);
+    if (!mem_resize(&log->edits, log->count, log->capacity, capacity)) {
+      LOG_ERROR(Save, "Out of memory for the save log, the edit is lost");
+      return false;
+    }
+    log->capacity = capacity;
+  }
+  if (log->count >= log->next_capacity) {
+    usize capacity = grow_capacity(log->next_capacity, log->count + 1);
+    if (!mem_resize(&log->next, log->count, log->next_capacity, capacity)) {
+      LOG_ERROR(Save, "Out of memory for the save log, the edit is lost");
+      return false;
+    }
+    log->next_capacity = capacity;
+  }
+  log->edits[log->count] = edit;
+  if (!save_log_index(log, u32(log->count))) {
+    LOG_ERROR(Save, "Out of memory for the save log, the edit is lost");
+    return false;
+  }
+  log->count++;
+  return true;
+}
+
+// forgets every edit, once they're in the host's snapshot
+void save_log_reset(SaveLog *log) {
+  log->count = log->flushed = 0;
+  log->chunk_count = 0;
+}
+
+void save_log_free(SaveLog *log) {
+  mem_free(log->edits, log->capacity * sizeof(SaveEdit));
+  mem_free(log->next, log->next_capacity * sizeof(u32));
+  mem_free(log->chunks, log->chunk_capacity * sizeof(SaveLogChunk));
+  *log = {};
+}
+
+// place_world_obj and remove_world_obj, kept in the save
+ObjectHandle edit_place_obj(SaveLog *log, World *world, Object obj) {
+  SaveEdit edit = {.kind = SaveEdit_Place, .object = save_object(obj)};
+  save_push(log, edit);
+  return place_world_obj(world, obj);
+}
+
+void edit_remove_obj(SaveLog *log, World *world, ObjectHandle handle) {
+  i32 index = world_find(world, handle);
+  if (index < 0) {
+    return;
+  }
+  SaveEdit edit = {.kind = SaveEdit_Remove, .object = save_object(world_obj(world, index))};
+  save_push(log, edit);
+  remove_world_obj(world, handle);
+}
+
+// sends the edits made since the last flush to the host, cost goes with the edits, not the world
+void save_flush(SaveLog *log, Inventory *inv) {
+  SaveInventory inventory = save_inventory(inv);
+  bool changed = inventory.selection != log->inventory.selection;
+  for (int i = 0; i < INVENTORY_ITEM_COUNT; ++i) {
+    changed |= inventory.items[i].item_type != log->inventory.items[i].item_type ||
+               inventory.items[i].item_count != log->inventory.items[i].item_count;
+  }
+  if (changed) {
+    SaveEdit edit = {.kind = SaveEdit_Inventory, .object = {}}; // the bytes past the inventory are zero
+    edit.inventory = inventory;
+    if (save_push(log, edit)) {
+      log->inventory = inventory;
+    }
+  }
+
+  if (log->count > log->flushed && !log->detached) {
+    save_append((const u8 *)(log->edits + log->flushed), (log->count - log->flushed) * sizeof(SaveEdit));
+    log->flushed = log->count;
+  }
+  log->since_flush = 0;
+}
+
+// applies the logged edits that land in chunk x, z, in order
+static void save_replay_chunk(SaveLog *log, World *world, i32 x, i32 z) {
+  SaveLogChunk *chunk = save_log_chunk_find(log, x, z);
+  for (u32 i = chunk != nullptr ? chunk->first : SAVE_EDIT_END; i != SAVE_EDIT_END; i = log->next[i]) {
+    SaveEdit *edit = &log->edits[i];
+    Object obj = save_object_load(&edit->object);
+    if (edit->kind == SaveEdit_Place) {
+      place_world_obj(world, obj);
+      continue;
+    }
+
+    ObjectHandle match = OBJ_HANDLE_NULL;
+    bvh_query_box(&world->bvh, {obj.pos, obj.pos}, [&](u32 slot) {
+      SaveObject other = save_object(world_obj(world, world_slot_index(world, slot)));
+      if (match.slot == OBJ_SLOT_NULL && save_object_eq(&other, &edit->object)) {
+        match = {slot, world->slots[slot].generation};
+      }
+    });
+    remove_world_obj(world, match);
+  }
+}
+
+PLATFORM_EXPORT void *chunk_buffer(usize size) {
+  return chunk_scratch_bytes(&state->chunks, size);
+}
+
+PLATFORM_EXPORT void chunk_loaded(int x, int z, const u8 *data, usize size) {
+  Chunk *chunk = chunk_find(&state->chunks, x, z);
+  // nobody asked, the store still has it
+  if (chunk == nullptr || chunk->state != ChunkState_Loading) {
+    return;
+  }
+  chunk->state = ChunkState_Resident;
+
+  // whatever got placed here before it loaded is in the log, and comes back with the replay
+  chunk_clear(&state->chunks, &state->world, x, z);
+
+  // the save these come from couldn't be read, they'd be garbage
+  if (state->save.detached) {
+    size = 0;
+  }
+  if (size % sizeof(SaveObject) != 0) {
+    LOG_WARN(Chunk, "Chunk ({}, {}) is cut short, dropping the last object", x, z);
+  }
+  for (usize i = 0; i < size / sizeof(SaveObject); ++i) {
+    SaveObject record;
+    __builtin_memcpy(&record, data + i * sizeof(SaveObject), sizeof(SaveObject));
+    place_world_obj(&state->world, save_object_load(&record));
+  }
+
+  save_replay_chunk(&state->save, &state->world, x, z);
+}
+
+// a new world gets its starting objects as edits, they show up once their chunk loads
+static void save_new_world(SaveLog *log) {
+  Object dirt_obj = default_obj(Shape_Cylinder);
+  dirt_obj.unbreakable = true;
+
+  Object tree_obj = default_obj(Shape_Cube);
+  tree_obj.drop = Item_Wood;
+  tree_obj.unbreakable = true;
+  tree_obj.scale = {0.2, 4.0, 0.2};
+  tree_obj.pos.y = 2.0f;
+
+  Object leaves_obj = default_obj(Shape_Cylinder);
+  leaves_obj.drop = Item_Leaves;
+  leaves_obj.unbreakable = false;
+  leaves_obj.scale = {1.0, 2.0, 1.0};
+  leaves_obj.pos.y = 3.0f;
+
+  Object objects[] = {dirt_obj, tree_obj, leaves_obj};
+  for (Object obj : objects) {
+    SaveEdit edit = {.kind = SaveEdit_Place, .object = save_object(obj)};
+    save_push(log, edit);
+  }
+}
+
+PLATFORM_EXPORT const SaveLayout *save_layout(void) {
+  static const SaveLayout layout = {
+    sizeof(SaveHeader), sizeof(SaveChunk), sizeof(SaveObject), sizeof(SaveEdit),
+    __builtin_offsetof(SaveHeader, chunk_count), __builtin_offsetof(SaveHeader, object_count),
+    __builtin_offsetof(SaveChunk, x), __builtin_offsetof(SaveChunk, z),
+    __builtin_offsetof(SaveChunk, first), __builtin_offsetof(SaveChunk, count),
+  };
+  return &layout;
+}
+
+// the header and the edit log. chunks can't be in the world yet, the edits are kept for when they load
+PLATFORM_EXPORT void save_loaded(const u8 *data, usize size) {
+  SaveLog *log = &state->save;
+  save_log_reset(log);
+  log->since_flush = 0;
+  state->inventory = {};
+  log->inventory = save_inventory(&state->inventory);
+
+  SaveHeader header = {};
+  if (size >= sizeof(SaveHeader)) {
+    __builtin_memcpy(&header, data, sizeof(SaveHeader));
+  }
+  log->detached = false;
+  if (size != 0 && (header.magic != SAVE_MAGIC || header.version != SAVE_VERSION)) {
+    LOG_ERROR(Save, "Save isn't version {}, playing a new world that won't be saved. the old save is kept as it is",
+              SAVE_VERSION);
+    log->detached = true;
+    save_new_world(log);
+    return;
+  }
+  if (size == 0) {
+    // an empty snapshot for the edits to go after, the host doesn't need to know how to make one
+    header = {SAVE_MAGIC, SAVE_VERSION, 0, 0, {}};
+    save_write((const u8 *)&header, sizeof(SaveHeader));
+    save_new_world(log);
+    return;
+  }
+
+  state->inventory = save_inventory_load(&header.inventory);
+  // a crash halfway through an append leaves a partial edit at the end, that one is dropped
+  for (usize at = sizeof(SaveHeader); at + sizeof(SaveEdit) <= size; at += sizeof(SaveEdit)) {
+    SaveEdit edit;
+    __builtin_memcpy(&edit, data + at, sizeof(SaveEdit));
+    if (edit.kind == SaveEdit_Inventory) {
+      state->inventory = save_inventory_load(&edit.inventory);
+    } else {
+      save_push(log, edit);
+    }
+  }
+  // already in the host's log
+  log->flushed = log->count;
+  log->inventory = save_inventory(&state->inventory);
+}
+
+// bakes the log into the host's snapshot and hands that to save_write. the log is flushed, so the host's has
+// the same edits. chunks are merged in order, each one's snapshot objects followed by its edits. a chunk left empty is dropped
+PLATFORM_EXPORT void save_snapshot_loaded(const u8 *data, usize size) {
+  SaveLog *log = &state->save;
+  SaveHeader header = {};
+  if (size >= sizeof(SaveHeader)) {
+    __builtin_memcpy(&header, data, sizeof(SaveHeader));
+  }
+  usize snapshot_size = sizeof(SaveHeader) + usize(header.chunk_count) * sizeof(SaveChunk) +
+                        usize(header.object_count) * sizeof(SaveObject);
+  if (header.magic != SAVE_MAGIC || header.version != SAVE_VERSION || snapshot_size > size) {
+    if (size != 0) {
+      LOG_WARN(Save, "Snapshot isn't version {}, not compacting", SAVE_VERSION);
+    }
+    return;
+  }
+  const u8 *snapshot_chunks = data + sizeof(SaveHeader);
+  const u8 *snapshot_objects = snapshot_chunks + header.chunk_count * sizeof(SaveChunk);
+
+  // enough room for every chunk there is and every object that ever got placed
+  usize places = 0;
+  for (usize i = 0; i < log->count; ++i) {
+    places += log->edits[i].kind == SaveEdit_Place;
+  }
+  usize max_chunks = header.chunk_count + log->chunk_count;
+  usize max_objects = header.object_count + places;
+  usize out_size = sizeof(SaveHeader) + max_chunks * sizeof(SaveChunk) + max_objects * sizeof(SaveObject);
+  u8 *out = (u8 *)mem_alloc(out_size);
+  if (out == nullptr) {
+    LOG_ERROR(Save, "Out of memory for compacting the save");
+    return;
+  }
+  SaveChunk *chunks = (SaveChunk *)(out + sizeof(SaveHeader));
+  SaveObject *objects = (SaveObject *)(chunks + max_chunks);
+  u32 chunk_count = 0, object_count = 0;
+
+  usize snapshot_at = 0, log_at = 0;
+  while (snapshot_at < header.chunk_count || log_at < log->chunk_count) {
+    SaveChunk snapshot = {};
+    if (snapshot_at < header.chunk_count) {
+      __builtin_memcpy(&snapshot, snapshot_chunks + snapshot_at * sizeof(SaveChunk), sizeof(SaveChunk));
+    }
+    SaveLogChunk *edits = log_at < log->chunk_count ? &log->chunks[log_at] : nullptr;
+    bool from_snapshot = snapshot_at < header.chunk_count &&
+      (edits == nullptr || snapshot.x < edits->x || (snapshot.x == edits->x && snapshot.z <= edits->z));
+    bool from_log = edits != nullptr &&
+      (!from_snapshot || (snapshot.x == edits->x && snapshot.z == edits->z));
+    i32 x = from_snapshot ? snapshot.x : edits->x;
+    i32 z = from_snapshot ? snapshot.z : edits->z;
+    u32 first = object_count;
+
+    if (from_snapshot) {
+      snapshot_at++;
+      if (snapshot.first + usize(snapshot.count) <= header.object_count) {
+        __builtin_memcpy(&objects[object_count], snapshot_objects + snapshot.first * sizeof(SaveObject),
+                         snapshot.count * sizeof(SaveObject));
+        object_count += snapshot.count;
+      }
+    }
+    if (from_log) {
+      log_at++;
+      for (u32 i = edits->first; i != SAVE_EDIT_END; i = log->next[i]) {
+        SaveEdit *edit = &log->edits[i];
+        if (edit->kind == SaveEdit_Place) {
+          objects[object_count++] = edit->object;
+          continue;
+        }
+        // the same one the replay would take out, the first that matches
+        for (u32 j = first; j < object_count; ++j) {
+          if (save_object_eq(&objects[j], &edit->object)) {
+            __builtin_memmove(&objects[j], &objects[j + 1], (object_count - j - 1) * sizeof(SaveObject));
+            object_count--;
+            break;
+          }
+        }
+      }
+    }
+
+    if (object_count > first) {
+      chunks[chunk_count++] = {x, z, first, object_count - first};
+    }
+  }
+
+  // the objects go right after the chunks that are left
+  if (chunk_count < max_chunks) {
+    __builtin_memmove(chunks + chunk_count, objects, object_count * sizeof(SaveObject));
+  }
+  header.chunk_count = chunk_count;
+  header.object_count = object_count;
+  header.inventory = log->inventory;
+  __builtin_memcpy(out, &header, sizeof(SaveHeader));
+
+  usize written = sizeof(SaveHeader) + chunk_count * sizeof(SaveChunk) + object_count * sizeof(SaveObject);
+  if (save_write(out, written)) {
+    save_log_reset(log);
+  } else {
+    LOG_WARN(Save, "Couldn't write the compacted save, keeping the log");
+  }
+  mem_free(out, out_size);
+}
+
+#define PICK_REACH 50.0f
+
+// returns the object closest along the ray, or OBJ_HANDLE_NULL if nothing is within PICK_REACH
+ObjectHandle pick_world_obj(World *world, Ray ray, RayHit *hit) {
+  PROFILE_ZONE("pick_world_obj");
+  ObjectHandle closest = OBJ_HANDLE_NULL;
+  hit->t = PICK_REACH;
+
+  bvh_raycast(&world->bvh, ray, PICK_REACH, [&](u32 slot, float) {
+    RayHit candidate;
+    u32 index = world_slot_index(world, slot);
+    if (ray_vs_object(ray, world->shape[index], world_transform(world, index), &candidate) && candidate.t < hit->t) {
+      *hit = candidate;
+      closest = {slot, world->slots[slot].generation};
+    }
+    return hit->t;
+  });
+
+  return closest;
+}
+
+Ray cam_ray(Camera *cam) {
+  return {cam->position, cam->forward};
+}
+
+Mat4 rect_vp_matrix(int x, int y, int w, int h) {
+  float aspect = float(state->window_w)/float(state->window_h);
+  x += w/2;
+  y += h/2;
+  float x_ = float(x) / state->window_w;
+  float y_ = float(y) / state->window_h;
+  x_ *= 2;
+  x_ -= 1;
+  y_ *= 2;
+  y_ -= 1;
+  static float n = 0.0;
+  return m4_translate({x_, -y_, 0}) * m4_isometric(state->window_w/w, state->window_h/h, 0.1, 1000.0) * m4_translate({0.0f, 0.0f, -100}); 
+}
+
+void render_inventory(Inventory *inv) {
+  const u8 selected_bitmap[] = {
+    0b11111111,
+    0b11111111,
+    0b11111111,
+    0b11111111,
+    0b11111111,
+    0b11111111,
+    0b11111111,
+    0b11111111,
+  };
+  const u8 not_selected_bitmap[] = {
+    0b11111111,
+    0b10000001,
+    0b10000001,
+    0b10000001,
+    0b10000001,
+    0b10000001,
+    0b10000001,
+    0b11111111,
+  };
+
+  // FIXME: The depth test toggling here seems kinda bad
+
+  for (int i = 0; i < INVENTORY_ITEM_COUNT; ++i) {
+    ItemStack slot = inv->items[i];
+    if (slot.item_type != Item_NULL) {
+      PUT_DEBUG_TEXT(20 + i * 80, state->window_h-32-32-16, "{} x{}", item_names[slot.item_type], int(slot.item_count));
+    }
+    int x = 20 + i * 80;
+    int y = state->window_h-32-32;
+
+    fgeo_set_vp(m4_identity());
+    render_8x8_bitmap(inv->selection == i ? selected_bitmap : not_selected_bitmap, x, y, 64, 64);
+
+    // TODO: Figure out why different resolutions put objects further back
+    switch (slot.item_type) {
+      case Item_Leaves:
+        fgeo_set_vp(rect_vp_matrix(x, y, 64, 64));
+        render_shape_colored(Shape_Cylinder, m4_scale(0.5f) * m4_rotate_x(-1) * m4_rotate_y(state->time), 1.0f);
+        break;
+      case Item_Wood:
+        fgeo_set_vp(rect_vp_matrix(x, y, 64, 64));
+        render_shape_colored(Shape_Cube, m4_scale(0.5f) * m4_rotate_x(-1) * m4_rotate_y(state->time), 1.0f);
+        break;
+      default:;
+    }
+  }
+  fgeo_set_vp(m4_identity());
+}
+
+void render_overlays(float dt) {
+  PROFILE_ZONE("render_overlays");
+  fgeo_set_vp(m4_identity());
+  select(SelectKey_DepthTest, false);
 
  
   // Debug
@@ -719,6 +2620,11 @@ void render_overlays(float dt) {
   render_8x8_bitmap(cursor_bitmap, state->window_w/2-8,  state->window_h/2-8, 16, 16);
 
   render_inventory(&state->inventory);
+#ifdef PROFILE
+  if (state->show_profile) {
+    render_profile();
+  }
+#endif
 
   flush_fgeo();
   select(SelectKey_DepthTest, true);
@@ -728,16 +2634,115 @@ void render_obj(Object *obj, float color = 1.0f) {
   render_shape_colored(obj->shape, object_model(obj), color);
 }
 
+#define BAKE_INSTANCES_SIZE (1 << 14)
+
+static Instance __bake_instances[Shape_COUNT][BAKE_INSTANCES_SIZE];
+
+// shape meshes live on the host under their Shape as id, the world only sends instances of them
+void upload_shape_meshes() {
+  for (int shape = 0; shape < Shape_COUNT; ++shape) {
+    Geo *src = shape_geos + shape;
+    mesh_upload(shape, src->ibuf, src->ibuf_len, src->vbuf, src->vbuf_len);
+  }
+}
+
+// rebuilds and uploads the instances of every region touched since the last call, grouped by shape
+void bake_mesh_regions(World *world) {
+  PROFILE_ZONE("bake_mesh_regions");
+  MeshRegions *meshes = &world->meshes;
+
+  for (usize i = 0; i < meshes->dirty_count; ++i) {
+    u32 id = meshes->dirty[i];
+    MeshRegion *region = &meshes->regions[id];
+    region->dirty = false;
+
+    int counts[Shape_COUNT] = {};
+    bool overflow = false;
+    Box bounds = {{MATH_INF, MATH_INF, MATH_INF}, {-MATH_INF, -MATH_INF, -MATH_INF}};
+
+    Vec3 min = Vec3{float(region->cell.x), float(region->cell.y), float(region->cell.z)} * MESH_REGION_SIZE;
+    Box box = {min, min + Vec3{MESH_REGION_SIZE, MESH_REGION_SIZE, MESH_REGION_SIZE}};
+    bvh_query_box(&world->bvh, box, [&](u32 slot) {
+      u32 index = world_slot_index(world, slot);
+      // objects sticking in from a neighbouring region get baked over there
+      if (!grid_cell_eq(mesh_region_cell(world_pos(world, index)), region->cell)) {
+        return;
+      }
+
+      Shape shape = world->shape[index];
+      if (counts[shape] >= BAKE_INSTANCES_SIZE) {
+        overflow = true;
+        return;
+      }
+      ObjectTransform *transform = world_transform(world, index);
+      __bake_instances[shape][counts[shape]++] = {transform->model, 1.0f};
+      bounds = box_union(bounds, object_bounds(transform));
+    });
+
+    Vec3 center = (bounds.min + bounds.max) * 0.5f;
+    meshes->sphere_x[id] = center.x;
+    meshes->sphere_y[id] = center.y;
+    meshes->sphere_z[id] = center.z;
+    meshes->sphere_r[id] = v3_length(bounds.max - bounds.min) * 0.5f;
+
+    if (overflow) {
+      LOG_WARN(Mesh, "Region is too big to bake, some objects are missing");
+    }
+
+    for (int shape = 0; shape < Shape_COUNT; ++shape) {
+      // empty buffers are skipped when drawing, unless they held something before
+      if (counts[shape] != 0 || region->instance_count[shape] != 0) {
+        instances_upload(MESH_REGION_INSTANCES_ID(id, shape), __bake_instances[shape], counts[shape]);
+      }
+      region->instance_count[shape] = counts[shape];
+    }
+
+    bool empty = true;
+    for (int shape = 0; shape < Shape_COUNT; ++shape) {
+      empty &= counts[shape] == 0;
+    }
+    if (empty) {
+      mesh_region_free(meshes, id);
+    }
+  }
+
+  meshes->dirty_count = 0;
+}
+
+// draws the regions that are at least partly in view of `vp`
+void render_mesh_regions(World *world, Mat4 vp) {
+  PROFILE_ZONE("render_mesh_regions");
+  MeshRegions *meshes = &world->meshes;
+  Frustum frustum = frustum_from_vp(vp);
+  frustum_cull_spheres(&frustum, meshes->sphere_x, meshes->sphere_y, meshes->sphere_z, meshes->sphere_r,
+                       meshes->count, meshes->visible);
+
+  meshes->object_count = meshes->culled_count = 0;
+  for (u32 id = 0; id < meshes->count; ++id) {
+    for (int shape = 0; shape < Shape_COUNT; ++shape) {
+      int instances = meshes->regions[id].instance_count[shape];
+      meshes->object_count += instances;
+      if (!meshes->visible[id]) {
+        meshes->culled_count += instances;
+      } else if (instances != 0) {
+        mesh_draw_instanced(shape, MESH_REGION_INSTANCES_ID(id, shape), vp);
+      }
+    }
+  }
+}
+
 void handle_block_gizmos() {
+  PROFILE_ZONE("handle_block_gizmos");
   ItemStack *hand = inv_hand(&state->inventory);
 
   switch (hand->item_type) {
     case Item_Wood: {
-      Object *focus = find_focus_obj(state->cam.position);
-      if (focus != nullptr) {
-        state->placing_obj = make_aligned_object(focus, &state->cam);
-        Object *maybe_occlusion = find_focus_obj(state->placing_obj.pos);
-        if (object_distance(&state->placing_obj, maybe_occlusion) > 0.99) { // find if we placed the block here (ERROR PRONE TEMPORARY)
+      i32 focus = find_focus_obj(state->cam.position);
+      if (focus >= 0) {
+        Object focus_obj = world_obj(&state->world, focus);
+        state->placing_obj = make_aligned_object(&focus_obj, &state->cam);
+        i32 maybe_occlusion = find_focus_obj(state->placing_obj.pos);
+        if (maybe_occlusion < 0 || object_distance(&state->placing_obj, world_pos(&state->world, maybe_occlusion)) > 0.99) { // find if we placed the block here (ERROR PRONE TEMPORARY)
           state->is_placing_floor = true;
         }
       }
@@ -750,16 +2755,17 @@ void handle_block_gizmos() {
 bool handle_block_placement(ItemStack item) {
   switch (item.item_type) {
     case Item_Wood: {
-      if (is_object_valid(state->facing_obj)) {
+      i32 facing = world_find(&state->world, state->facing_obj);
+      if (facing >= 0) {
         Object new_obj = default_obj(Shape_Cube);
         new_obj.drop = Item_Wood;
-        new_obj.rot = state->facing_obj->rot;
+        new_obj.rot = state->world.rot[facing];
         new_obj.scale.y = 2.0;
-        new_obj.pos = state->facing_obj->pos + Vec3{0, 1.5, 0};
-        place_world_obj(&state->world, new_obj);
+        new_obj.pos = world_pos(&state->world, facing) + Vec3{0, 1.5, 0};
+        edit_place_obj(&state->save, &state->world, new_obj);
         return true;
       } else if (state->is_placing_floor) {
-        place_world_obj(&state->world, state->placing_obj);
+        edit_place_obj(&state->save, &state->world, state->placing_obj);
         return true;
       }
     } break;
@@ -770,92 +2776,419 @@ bool handle_block_placement(ItemStack item) {
   return false;
 }
 
-void run_player_motion(Vec3 motion) {
-  const int integrations = 20;
-  Vec3 pos = state_get_foot(state);
-  Vec3 newPos = pos + motion;
-  Vec3 delta = (pos-newPos) * 1/float(integrations);
-
-
-  for (usize i = 0; i < state->world.object_count; ++i) {
-    Object *obj = &state->world.objects[i];
-    if (is_object_valid(obj)) {
-      TransformBox tb = object_make_transform_box(obj);
-      if (point_vs_transform_box(newPos, tb)) {
-        for (int i = 0; i < integrations && point_vs_transform_box(newPos, tb); ++i) {
-          newPos += delta;
-        }
-        break;
+#define PLAYER_HALF_SIZE Vec3{0.3f, 0.85f, 0.3f} // the player's box, standing on the foot
+#define SWEEP_ITERATIONS 4 // slides along at most this many faces per step
+#define SWEEP_SKIN 0.001f // gap left between the player and what it ran into
+
+struct SweepHit {
+  float t; // fraction of the motion the box gets through
+  Vec3 normal;
+  float depth; // how far the box already was inside it, 0 unless it started in there
+};
+
+// the face of `tb` that `pos`, inside it, is closest to getting out through
+SweepHit transform_box_exit(TransformBox tb, Vec3 pos) {
+  Vec3 local = tb.transform * pos;
+  float o[3] = {local.x, local.y, local.z};
+  float lo[3] = {tb.box.min.x, tb.box.min.y, tb.box.min.z};
+  float hi[3] = {tb.box.max.x, tb.box.max.y, tb.box.max.z};
+
+  SweepHit exit = {0, {}, MATH_INF};
+  for (int a = 0; a < 3; ++a) {
+    for (float sign = -1; sign <= 1; sign += 2) {
+      float n[3] = {0, 0, 0};
+      n[a] = sign;
+      // the transform scales, so a local distance is this many times the one in world space
+      Vec3 normal = m4_mul_dir(m4_transpose(tb.transform), {n[0], n[1], n[2]});
+      float scale = v3_length(normal);
+      float depth = (sign < 0 ? o[a] - lo[a] : hi[a] - o[a]) / scale;
+      if (depth < exit.depth) {
+        exit.normal = normal * (1 / scale);
+        exit.depth = depth;
+      }
+    }
+  }
+  return exit;
+}
+
+// first object `box` runs into moving by `motion`. only looks at the objects the BVH has around the path,
+// ties go to the deepest one and then the lowest slot so replays agree.
+// an object the box already overlaps is a hit at t = 0 with the way out of it, unless the motion is
+// taking the box out already. cylinders are treated as the box they're inscribed in
+bool sweep_box(World *world, Box box, Vec3 motion, SweepHit *hit) {
+  Vec3 center = box_origin(box);
+  Vec3 half = (box.max - box.min) * 0.5f;
+  Ray ray = {center, motion};
+  bool found = false;
+  u32 hit_slot = 0;
+  *hit = {1, {}, 0};
+
+  bvh_query_box(&world->bvh, box_union(box, box_translate(box, motion)), [&](u32 slot) {
+    u32 index = world_slot_index(world, slot);
+    TransformBox tb = transform_box_expand(object_make_transform_box(world_transform(world, index)), half);
+    SweepHit candidate;
+    if (point_vs_transform_box(center, tb)) {
+      candidate = transform_box_exit(tb, center);
+    } else {
+      RayHit ray_hit;
+      if (!ray_vs_box(ray, tb, &ray_hit) || ray_hit.t > 1) {
+        return;
       }
+      candidate = {ray_hit.t, ray_hit.normal, 0};
+    }
+    if (v3_dot(motion, candidate.normal) >= 0) {
+      return;
+    }
+    if (!found || candidate.t < hit->t || (candidate.t == hit->t && candidate.depth > hit->depth) ||
+        (candidate.t == hit->t && candidate.depth == hit->depth && slot < hit_slot)) {
+      *hit = candidate;
+      hit_slot = slot;
+      found = true;
+    }
+  });
+
+  return found;
+}
+
+// moves the player by `motion`, stopping at whatever is in the way and sliding along it with what's left.
+// far from the origin the skin is below what a float can hold, so the player does end up touching or
+// inside things now and then, and gets pushed back out of them
+void run_player_motion(Vec3 motion) {
+  PROFILE_ZONE("run_player_motion");
+  Vec3 half = PLAYER_HALF_SIZE;
+  Vec3 center = state_get_foot(state) + Vec3{0, half.y, 0};
+
+  for (int i = 0; i < SWEEP_ITERATIONS; ++i) {
+    if (v3_length(motion) == 0) {
+      break;
+    }
+
+    SweepHit hit;
+    if (!sweep_box(&state->world, {center - half, center + half}, motion, &hit)) {
+      center += motion;
+      break;
+    }
+
+    // the skin is along the normal, at a grazing angle that's a lot further back along the motion
+    float into = -v3_dot(motion, hit.normal);
+    if (hit.depth > 0) {
+      center += hit.normal * (hit.depth + SWEEP_SKIN);
+    } else {
+      float t = hit.t - SWEEP_SKIN / into;
+      center += motion * (t > 0 ? t : 0);
+      motion = motion * (1 - hit.t);
+      into *= 1 - hit.t;
     }
+    motion += hit.normal * into;
   }
 
-  state_set_foot(state, newPos);
+  state_set_foot(state, center - Vec3{0, half.y, 0});
 }
 
 void run_physics(float dt) {
-  Vec3 motion = cam_make_motion_relative(&state->cam, Vec3{(state->keys[Key_D] - state->keys[Key_A]) * dt,
-     (state->keys[Key_Space] - state->keys[Key_Shift]) * dt,
-     (state->keys[Key_W] - state->keys[Key_S]) * dt});
-
-#if 0
-  run_player_motion({0, motion.y, 0});
-  run_player_motion({0, 0, motion.z});
-  run_player_motion({motion.x, 0, 0});
-#else
-  state->cam.position += motion;
-#endif
+  PROFILE_ZONE("run_physics");
+  auto held = [](Action action) { return state->held[action] != 0 ? 1.0f : 0.0f; };
+  Vec3 motion = cam_make_motion_relative(&state->cam, Vec3{(held(Action_Right) - held(Action_Left)) * dt,
+     (held(Action_Up) - held(Action_Down)) * dt,
+     (held(Action_Forward) - held(Action_Back)) * dt});
+
+  run_player_motion(motion);
+}
+
+void record_flush(Recorder *rec) {
+  if (rec->count != 0) {
+    record_append((const u8 *)rec->events, rec->count * sizeof(RecordEvent));
+    rec->count = 0;
+  }
+}
+
+// keeps `event` if recording, stamped with the game time
+void record(Recorder *rec, RecordEvent event) {
+  if (!rec->recording) {
+    return;
+  }
+  event.time = state->time;
+  if (rec->count >= RECORD_BUFFER_SIZE) {
+    record_flush(rec);
+  }
+  rec->events[rec->count++] = event;
+}
+
+void record_bind(Scancode code, Action action) {
+  RecordEvent event = {.kind = Record_Bind, .time = 0, .bind = {}};
+  const char *scancode = scancode_names[code];
+  for (int i = 0; i < RECORD_SCANCODE_SIZE - 1 && scancode[i] != '\0'; ++i) {
+    event.bind.scancode[i] = scancode[i];
+  }
+  event.bind.action = action;
+  record(&state->recorder, event);
+}
+
+void bindings_default(Action *bindings);
+
+PLATFORM_EXPORT void record_start(void) {
+  Recorder *rec = &state->recorder;
+  RecordHeader header = {RECORD_MAGIC, RECORD_VERSION};
+  record_append((const u8 *)&header, sizeof(RecordHeader));
+  rec->recording = true;
+  rec->count = 0;
+
+  // replays start from the defaults, so the keys bound before now go first
+  Action defaults[Scancode_COUNT];
+  bindings_default(defaults);
+  for (int i = 1; i < Scancode_COUNT; ++i) {
+    if (state->bindings[i] != defaults[i]) {
+      record_bind(Scancode(i), state->bindings[i]);
+    }
+  }
+}
+
+// starts the world over from the host's save, chunks come back in as the camera streams them
+void state_load(State *state) {
+  world_clear(&state->world);
+  state->chunks.count = 0;
+  save_load();
+}
+
+// Scancode_None if it isn't one of ours
+Scancode scancode_find(const char *name) {
+  Scancode code = Scancode(scancode_table.codes[scancode_hash(name, scancode_table.seed)]);
+  return strcmp(name, scancode_names[code]) == 0 ? code : Scancode_None;
+}
+
+// Action_None if there's no such action
+Action action_find(const char *name) {
+  for (int i = 1; i < Action_COUNT; ++i) {
+    if (strcmp(name, action_names[i]) == 0) {
+      return Action(i);
+    }
+  }
+  return Action_None;
+}
+
+void bindings_default(Action *bindings) {
+  for (int i = 0; i < Scancode_COUNT; ++i) {
+    bindings[i] = Action_None;
+  }
+  bindings[Scancode_KeyW] = Action_Forward;
+  bindings[Scancode_KeyS] = Action_Back;
+  bindings[Scancode_KeyA] = Action_Left;
+  bindings[Scancode_KeyD] = Action_Right;
+  bindings[Scancode_Space] = Action_Up;
+  bindings[Scancode_ShiftLeft] = Action_Down;
+  bindings[Scancode_Digit1] = Action_Slot1;
+  bindings[Scancode_Digit2] = Action_Slot2;
+  bindings[Scancode_KeyP] = Action_ToggleProfile;
+}
+
+// binds the key to the action, "None" unbinds it. a key that's down moves over to the new action
+PLATFORM_EXPORT bool key_bind(const char *scancode, const char *action) {
+  Scancode code = scancode_find(scancode);
+  Action bound = action_find(action);
+  if (code == Scancode_None || (bound == Action_None && strcmp(action, "None") != 0)) {
+    return false;
+  }
+  record_bind(code, bound);
+  if (state->down[code]) {
+    state->held[state->bindings[code]]--;
+    state->held[bound]++;
+  }
+  state->bindings[code] = bound;
+  return true;
+}
+
+void handle_key(Scancode code, bool down) {
+  // the host's key repeat, and a key up after the focus came back, don't change anything
+  if (state->down[code] == down) {
+    return;
+  }
+  state->down[code] = down;
+
+  RecordEvent event = {.kind = Record_Key, .time = 0, .key = {down, {}}};
+  const char *scancode = scancode_names[code];
+  for (int i = 0; i < RECORD_SCANCODE_SIZE - 1 && scancode[i] != '\0'; ++i) {
+    event.key.scancode[i] = scancode[i];
+  }
+  record(&state->recorder, event);
+
+  Action action = state->bindings[code];
+  if (!down) {
+    state->held[action]--;
+    return;
+  }
+  state->held[action]++;
+
+  switch (action) {
+    case Action_Slot1:
+      state->inventory.selection = 0;
+      break;
+    case Action_Slot2:
+      state->inventory.selection = 1;
+      break;
+    case Action_ToggleProfile:
+      state->show_profile = !state->show_profile;
+      break;
+    default:;
+  }
+}
+
+PLATFORM_EXPORT void keyhit(bool down, const char *scancode) {
+  Scancode code = scancode_find(scancode);
+  if (code != Scancode_None) {
+    handle_key(code, down);
+  }
+}
+
+PLATFORM_EXPORT void resize(int width, int height) {
+  RecordEvent event = {.kind = Record_Resize, .time = 0, .resize = {width, height}};
+  record(&state->recorder, event);
+
+  state->window_w = width;
+  state->window_h = height;
+  state->aspect = state->cam.aspect = width / float(height);
+}
+
+void handle_mousemove(int x, int y, int dx, int dy) {
+  RecordEvent event = {.kind = Record_MouseMove, .time = 0, .move = {x, y, dx, dy}};
+  record(&state->recorder, event);
+
+  cam_move(&state->cam, {float(dy)/300.0f, float(dx)/300.0f, 0}, {0, 0, 0});
+}
+
+void handle_mousehit(bool down, int button) {
+  RecordEvent event = {.kind = Record_MouseHit, .time = 0, .hit = {down, button}};
+  record(&state->recorder, event);
+
+  // Wall placement
+  if (down && button == 2) {
+    ItemStack ejected = inv_eject(&state->inventory);
+    if (handle_block_placement(ejected) == false) {
+      // put back if failed
+      inv_put(&state->inventory, ejected);
+    }
+  }
+  i32 facing = world_find(&state->world, state->facing_obj);
+  if (down && button == 0 && facing >= 0) {
+    Item drop = state->world.drop[facing];
+    if (state->world.unbreakable[facing] == false) {
+      edit_remove_obj(&state->save, &state->world, state->facing_obj);
+    }
+    inv_put(&state->inventory, {drop, 1});
+  }
+}
+
+PLATFORM_EXPORT void mousemove(int x, int y, int dx, int dy) {
+  handle_mousemove(x, y, dx, dy);
+}
+
+PLATFORM_EXPORT void mousehit(bool down, int button) {
+  handle_mousehit(down, button);
+}
+
+InputRing input_ring_memory;
+
+PLATFORM_EXPORT InputRing *input_ring(void) {
+  return &input_ring_memory;
+}
+
+PLATFORM_EXPORT const char *input_scancode_name(int code) {
+  return code > 0 && code < Scancode_COUNT ? scancode_names[code] : nullptr;
+}
+
+PLATFORM_EXPORT const char *input_action_name(int action) {
+  return action >= 0 && action < Action_COUNT ? action_names[action] : nullptr;
+}
+
+// runs everything the host queued since the last frame, in order
+void input_drain(InputRing *ring) {
+  for (; ring->read != ring->write; ++ring->read) {
+    InputEvent *event = &ring->events[ring->read % INPUT_RING_SIZE];
+    switch (event->kind) {
+      case Input_Key:
+        if (event->key.code > 0 && event->key.code < Scancode_COUNT) {
+          handle_key(Scancode(event->key.code), event->key.down);
+        }
+        break;
+      case Input_MouseHit:
+        handle_mousehit(event->hit.down, event->hit.button);
+        break;
+      case Input_MouseMove:
+        handle_mousemove(event->move.x, event->move.y, event->move.dx, event->move.dy);
+        break;
+      default:;
+    }
+  }
+}
+
+// runs as many steps as fit in the time since the last frame, then puts the camera in between the last two
+void sim_advance(SimClock *sim, float dt) {
+  sim->accumulator += dt;
+  state->cam.position = sim->now;
+
+  int steps = 0;
+  for (; sim->accumulator >= SIM_STEP && steps < SIM_MAX_STEPS; ++steps) {
+    sim->prev = state->cam.position;
+    run_physics(SIM_STEP);
+    sim->accumulator -= SIM_STEP;
+  }
+  if (sim->accumulator >= SIM_STEP) {
+    sim->accumulator = 0;
+  }
+
+  sim->now = state->cam.position;
+  sim->alpha = sim->accumulator / SIM_STEP;
+  state->cam.position = v3_lerp(sim->prev, sim->now, sim->alpha);
 }
 
 PLATFORM_EXPORT void frame(float dt) {
+  PROFILE_FRAME();
+  PROFILE_ZONE("frame");
+  // recorded ahead of the frame, the same order they'd be in without the ring
+  input_drain(&input_ring_memory);
+
+  RecordEvent event = {.kind = Record_Frame, .time = 0, .dt = dt};
+  record(&state->recorder, event);
+
   state->time += dt;
-  if (dt > 0.01) {
-    dt = 0.01;
+  state->save.since_flush += dt;
+  if (state->save.since_flush >= SAVE_INTERVAL) {
+    save_flush(&state->save, &state->inventory);
+    if (state->save.count >= SAVE_COMPACT_EDITS && !state->save.detached) {
+      save_compact();
+    }
   }
-  run_physics(dt);
 
-  fgeo_set_vp(cam_vp(&state->cam));
+  sim_advance(&state->sim, dt);
+  stream_chunks(&state->chunks, &state->world, state->cam.position);
+
+  // the camera is settled for the frame, everything below shares its view
+  Mat4 vp = cam_vp(&state->cam);
+  fgeo_set_vp(vp);
 
   static float theta = 0;
 
   fgeo_flush_generation = 0;
   theta += dt;
 
-  state->facing_obj = nullptr;
+  state->facing_obj = OBJ_HANDLE_NULL;
   state->is_placing_floor = false;
 
   handle_block_gizmos();
 
-  Vec3 oldHitPoint { -1000000000, -10000000000, -10000000000 };
-  for (int i = 0; i < state->world.object_count; ++i) {
-    Object *obj = &state->world.objects[i];
-    if (obj->exists) {
-      Vec3 hitPoint;
-
-      if (ray_vs_box(cam_ray(&state->cam), object_make_transform_box(obj), &hitPoint)) {
-        if (state->facing_obj == nullptr) {
-          state->is_placing_floor = false;
-          state->facing_obj = obj;
-        } else {
-          float distance_a = object_distance(state->facing_obj, oldHitPoint);
-          float distance_b = object_distance(obj, hitPoint);
-          if (distance_b < distance_a) {
-            oldHitPoint = hitPoint;
-            render_obj(state->facing_obj);
-            state->is_placing_floor = false;
-            state->facing_obj = obj;
-          } else {
-            render_obj(obj);
-          }
-        }
-      } else {
-        render_obj(obj);
-      }
-    }
+  RayHit hit;
+  state->facing_obj = pick_world_obj(&state->world, cam_ray(&state->cam), &hit);
+  i32 facing = world_find(&state->world, state->facing_obj);
+  if (facing >= 0) {
+    state->is_placing_floor = false;
   }
 
-  if (state->facing_obj) {
-    render_obj(state->facing_obj, 0.3);
+  bake_mesh_regions(&state->world);
+  render_mesh_regions(&state->world, vp);
+
+  if (facing >= 0) {
+    // the baked copy is already drawn, go over it slightly inflated so this one wins the depth test
+    ObjectTransform *transform = world_transform(&state->world, facing);
+    render_shape_colored(state->world.shape[facing], transform->model * m4_scale(1.01f), transform->normal, 0.3f);
   }
 
   if (state->is_placing_floor) {
@@ -867,11 +3200,15 @@ PLATFORM_EXPORT void frame(float dt) {
   render_overlays(dt);
   
   flush_fgeo();
+  record_flush(&state->recorder);
+  log_flush_frame();
 }
 
 PLATFORM_EXPORT void init(void) {
   {
     Geo *geo = shape_geos + Shape_Cylinder;
+    // built from scratch, init can run again to start over
+    geo->ibuf_len = geo->vbuf_len = 0;
     auto vert = [geo](float x, float y, float z, Vec3 norm = {0, 0, 1}) {
       Vert v = {0};
       v.pos = Vec3{x, y, z};
@@ -899,83 +3236,28 @@ PLATFORM_EXPORT void init(void) {
     }
   }
 
+  for (int shape = 0; shape < Shape_COUNT; ++shape) {
+    geo_compute_normals(shape_geos + shape);
+  }
+  upload_shape_meshes();
+
+  // init runs again for every replay and bench, what the last run allocated goes back first
+  if (state != nullptr) {
+    world_free(&state->world);
+    chunk_stream_free(&state->chunks);
+    save_log_free(&state->save);
+  }
   state = &state_memory;
+  __builtin_memset(state, 0, sizeof(State));
+  fgeo.ibuf_len = fgeo.vbuf_len = 0;
+  fgeo_vp = {};
   state->aspect = state->cam.aspect = 1;
   state->cam.fov = MATH_PI_2/2;
+  cam_set_rotation(&state->cam, {0, 0, 0});
   state->cam.position = {0.3, 2, 0.3};
+  state->sim.prev = state->sim.now = state->cam.position;
+  bindings_default(state->bindings);
 
-  Object dirt_obj = default_obj(Shape_Cylinder);
-  dirt_obj.unbreakable = true;
-
-  place_world_obj(&state->world, dirt_obj);
-
-  Object tree_obj = default_obj(Shape_Cube);
-  tree_obj.drop = Item_Wood;
-  tree_obj.unbreakable = true;
-  tree_obj.scale = {0.2, 4.0, 0.2};
-  tree_obj.pos.y = 2.0f;
-
-  place_world_obj(&state->world, tree_obj);
-
-  Object leaves_obj = default_obj(Shape_Cylinder);
-  leaves_obj.drop = Item_Leaves;
-  leaves_obj.unbreakable = false;
-  leaves_obj.scale = {1.0, 2.0, 1.0};
-  leaves_obj.pos.y = 3.0f;
-  place_world_obj(&state->world, leaves_obj);
-
-}
-
-PLATFORM_EXPORT void keyhit(bool down, const char *scancode) {
-  const char *map[Key_COUNT];
-  map[Key_Shift] = "ShiftLeft";
-  map[Key_Space] = "Space";
-  map[Key_W] = "KeyW";
-  map[Key_S] = "KeyS";
-  map[Key_A] = "KeyA";
-  map[Key_D] = "KeyD";
-
-
-  for (int i = 0; i < Key_COUNT; ++i) {
-    if (strcmp(scancode, map[i]) == 0) {
-      state->keys[i] = down;
-    }
-  }
-
-  if (strcmp(scancode, "Digit1") == 0 && down) {
-    state->inventory.selection = 0;
-  }
-
-  if (strcmp(scancode, "Digit2") == 0 && down) {
-    state->inventory.selection = 1;
-  }
-}
-
-PLATFORM_EXPORT void resize(int width, int height) {
-  state->window_w = width;
-  state->window_h = height;
-  state->aspect = state->cam.aspect = width / float(height);
-}
-
-PLATFORM_EXPORT void mousemove(int x, int y, int dx, int dy) {
-  cam_move(&state->cam, {float(dy)/300.0f, float(dx)/300.0f, 0}, {0, 0, 0});
-}
-
-PLATFORM_EXPORT void mousehit(bool down, int button) {
-  // Wall placement
-  if (down && button == 2) {
-    ItemStack ejected = inv_eject(&state->inventory);
-    if (handle_block_placement(ejected) == false) {
-      // put back if failed
-      inv_put(&state->inventory, ejected);
-    }
-  }
-  if (down && button == 0 && is_object_valid(state->facing_obj)) {
-    if (state->facing_obj->unbreakable == false) {
-      state->facing_obj->exists = false;
-    }
-    inv_put(&state->inventory, {state->facing_obj->drop, 1});
-  }
+  world_init(&state->world);
+  state_load(state);
 }
-
-
@@ -4,12 +4,64 @@
 #define MATH_TAU 6.283185307179586
 #define MATH_PI 3.141592653589793
 #define MATH_PI_2 1.5707963267948966
+#define MATH_INF __builtin_inff()
 
 
 #define cos(x) __builtin_cos(x)
 #define sin(x) __builtin_sin(x)
 #define fmod(x, y) __builtin_fmod(x, y)
 #define sqrt(x) __builtin_sqrt(x)
+#define floor(x) __builtin_floor(x)
+
+/* trig */
+
+// sin and cos of x at once, without libm (which is a slow software call on wasm). x is brought into
+// [-pi/4, pi/4] around the nearest multiple of pi/2 and both come from minimax polynomials there.
+// off from the real ones by at most 1e-7 for |x| < 8192, past that the reduction starts losing bits
+inline void math_sincos(float x, float *s, float *c) {
+  float q = __builtin_floorf(x * float(2 / MATH_PI) + 0.5f);
+  // pi/2 in three parts, each exact when multiplied by q
+  float r = x - q * 1.5703125f;
+  r -= q * 4.837512969970703125e-4f;
+  r -= q * 7.54978995489188216e-8f;
+
+  float z = r * r;
+  float sin_r = ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * r + r;
+  float cos_r = ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z - 0.5f * z + 1.0f;
+
+  // quadrants 1 and 3 swap the two, sin is negative in 2 and 3, cos in 1 and 2. selects, not branches
+  int quadrant = int(q);
+  bool swap = quadrant & 1;
+  float sin_x = swap ? cos_r : sin_r;
+  float cos_x = swap ? sin_r : cos_r;
+  *s = quadrant & 2 ? -sin_x : sin_x;
+  *c = (quadrant + 1) & 2 ? -cos_x : cos_x;
+}
+
+/* SIMD */
+
+// 4 wide vectors through compiler vector extensions: simd128 on wasm, sse/neon natively.
+// -DMATH_SCALAR swaps the Mat4 kernels below for plain loops, to compare against or for targets without them
+typedef float f32x4 __attribute__((vector_size(16)));
+typedef i32 i32x4 __attribute__((vector_size(16)));
+
+inline f32x4 f32x4_splat(float v) {
+  return f32x4{v, v, v, v};
+}
+
+inline f32x4 f32x4_load(const float *p) {
+  f32x4 ret;
+  __builtin_memcpy(&ret, p, sizeof ret);
+  return ret;
+}
+
+inline void f32x4_store(float *p, f32x4 v) {
+  __builtin_memcpy(p, &v, sizeof v);
+}
+
+inline bool i32x4_any(i32x4 mask) {
+  return (mask[0] | mask[1] | mask[2] | mask[3]) != 0;
+}
 
 /* Vec3 */
 
@@ -77,9 +129,13 @@ inline Vec3 v3_cross(Vec3 a, Vec3 b) {
   return {a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x};
 }
 
+inline Vec3 v3_lerp(Vec3 a, Vec3 b, float t) {
+  return a + (b - a) * t;
+}
+
 /* Mat4 */
 
-inline Vec3 operator*(Mat4 a, Vec3 b) {
+inline Vec3 m4_mul_point_scalar(Mat4 a, Vec3 b) {
   float data[4] = {b.x, b.y, b.z, 1.0};
   float ret[4] = {};
 
@@ -92,11 +148,67 @@ inline Vec3 operator*(Mat4 a, Vec3 b) {
   return {ret[0], ret[1], ret[2]};
 }
 
+// one column per lane group, summed in the same order as the scalar loop so both give the same bits
+inline Vec3 m4_mul_point_simd(Mat4 a, Vec3 b) {
+  f32x4 ret = f32x4_load(a.num[0]) * f32x4_splat(b.x) +
+              f32x4_load(a.num[1]) * f32x4_splat(b.y) +
+              f32x4_load(a.num[2]) * f32x4_splat(b.z) +
+              f32x4_load(a.num[3]);
+  return {ret[0], ret[1], ret[2]};
+}
+
+inline Vec3 operator*(Mat4 a, Vec3 b) {
+#ifdef MATH_SCALAR
+  return m4_mul_point_scalar(a, b);
+#else
+  return m4_mul_point_simd(a, b);
+#endif
+}
+
 inline Vec3 operator*(Vec3 b, Mat4 a) {
   return a * b;
 }
 
-inline Mat4 operator*(Mat4 a, Mat4 b) {
+// like `a * b`, but treats b as a direction (w = 0) so translation is ignored
+inline Vec3 m4_mul_dir(Mat4 a, Vec3 b) {
+  return {
+    a.num[0][0] * b.x + a.num[1][0] * b.y + a.num[2][0] * b.z,
+    a.num[0][1] * b.x + a.num[1][1] * b.y + a.num[2][1] * b.z,
+    a.num[0][2] * b.x + a.num[1][2] * b.y + a.num[2][2] * b.z,
+  };
+}
+
+inline Mat4 m4_transpose(Mat4 a) {
+  Mat4 ret;
+
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      ret.num[i][j] = a.num[j][i];
+    }
+  }
+
+  return ret;
+}
+
+// matrix for transforming normals by `a`: the cofactors of its upper 3x3, which is the inverse
+// transpose scaled by the determinant. normals need normalizing after, use with m4_mul_dir
+inline Mat4 m4_normal(Mat4 a) {
+  Vec3 c0 = {a.num[0][0], a.num[0][1], a.num[0][2]},
+       c1 = {a.num[1][0], a.num[1][1], a.num[1][2]},
+       c2 = {a.num[2][0], a.num[2][1], a.num[2][2]};
+  Vec3 n0 = v3_cross(c1, c2),
+       n1 = v3_cross(c2, c0),
+       n2 = v3_cross(c0, c1);
+
+  Mat4 ret = {};
+  ret.num[0][0] = n0.x; ret.num[0][1] = n0.y; ret.num[0][2] = n0.z;
+  ret.num[1][0] = n1.x; ret.num[1][1] = n1.y; ret.num[1][2] = n1.z;
+  ret.num[2][0] = n2.x; ret.num[2][1] = n2.y; ret.num[2][2] = n2.z;
+  ret.num[3][3] = 1;
+  return ret;
+}
+
+inline Mat4 m4_mul_scalar(Mat4 a, Mat4 b) {
   Mat4 ret = {};
 
   for (int i = 0; i < 4; ++i) {
@@ -110,10 +222,63 @@ inline Mat4 operator*(Mat4 a, Mat4 b) {
   return ret;
 }
 
+// column i of the result is a's columns weighted by column i of b
+inline Mat4 m4_mul_simd(Mat4 a, Mat4 b) {
+  f32x4 c0 = f32x4_load(a.num[0]), c1 = f32x4_load(a.num[1]),
+        c2 = f32x4_load(a.num[2]), c3 = f32x4_load(a.num[3]);
+  Mat4 ret;
+
+  for (int i = 0; i < 4; ++i) {
+    f32x4_store(ret.num[i], c0 * f32x4_splat(b.num[i][0]) + c1 * f32x4_splat(b.num[i][1]) +
+                            c2 * f32x4_splat(b.num[i][2]) + c3 * f32x4_splat(b.num[i][3]));
+  }
+
+  return ret;
+}
+
+inline Mat4 operator*(Mat4 a, Mat4 b) {
+#ifdef MATH_SCALAR
+  return m4_mul_scalar(a, b);
+#else
+  return m4_mul_simd(a, b);
+#endif
+}
+
 inline Mat4 operator*=(Mat4 &a, Mat4 b) {
   return a = a * b;
 }
 
+/* batched: dst[i] is src[i] with its position transformed by m, the rest copied over. dst may be src */
+inline void transform_points_scalar(Mat4 m, const Vert *src, Vert *dst, int n) {
+  for (int i = 0; i < n; ++i) {
+    Vert vert = src[i];
+    vert.pos = m4_mul_point_scalar(m, vert.pos);
+    dst[i] = vert;
+  }
+}
+
+// the columns stay in registers for the whole batch, each vertex is three multiply-adds
+inline void transform_points_simd(Mat4 m, const Vert *src, Vert *dst, int n) {
+  f32x4 c0 = f32x4_load(m.num[0]), c1 = f32x4_load(m.num[1]),
+        c2 = f32x4_load(m.num[2]), c3 = f32x4_load(m.num[3]);
+
+  for (int i = 0; i < n; ++i) {
+    Vert vert = src[i];
+    f32x4 pos = c0 * f32x4_splat(vert.pos.x) + c1 * f32x4_splat(vert.pos.y) +
+                c2 * f32x4_splat(vert.pos.z) + c3;
+    vert.pos = {pos[0], pos[1], pos[2]};
+    dst[i] = vert;
+  }
+}
+
+inline void transform_points(Mat4 m, const Vert *src, Vert *dst, int n) {
+#ifdef MATH_SCALAR
+  transform_points_scalar(m, src, dst, n);
+#else
+  transform_points_simd(m, src, dst, n);
+#endif
+}
+
 inline Mat4 m4_scale(Vec3 scale) {
   return {
     scale.x, 0,       0,       0,
@@ -137,11 +302,13 @@ inline Mat4 m4_identity() {
 }
 
 inline Mat4 m4_rotation2d(float theta) {
+  float s, c;
+  math_sincos(theta, &s, &c);
   return {
-    float(cos(theta)), float(-sin(theta)), 0, 0,
-    float(sin(theta)), float(cos(theta)),  0, 0,
-    0,                 0,                  1, 0,
-    0,                 0,                  0, 1
+    c, -s, 0, 0,
+    s,  c, 0, 0,
+    0,  0, 1, 0,
+    0,  0, 0, 1
   };
 }
 
@@ -175,7 +342,9 @@ inline Mat4 m4_perspective2(float l, float t, float r, float b, float near, floa
 }
 
 inline Mat4 m4_perspective(float fov, float aspect, float near, float far) {
-  float height = cos(fov) / sin(fov);
+  float s, c;
+  math_sincos(fov, &s, &c);
+  float height = c / s;
   float width = height / aspect;
   float f_range = far / (far - near);
   return {
@@ -186,9 +355,9 @@ inline Mat4 m4_perspective(float fov, float aspect, float near, float far) {
   };
 }
 
-static Mat4 m4_rotate_x(float angle) {
-  float c = cos(angle);
-  float s = sin(angle);
+inline Mat4 m4_rotate_x(float angle) {
+  float s, c;
+  math_sincos(angle, &s, &c);
   return {
     1.0f, 0.0f, 0.0f, 0.0f,
     0.0f,    c,    s, 0.0f,
@@ -197,9 +366,9 @@ static Mat4 m4_rotate_x(float angle) {
   };
 }
 
-static Mat4 m4_rotate_y(float angle) {
-  float c = cos(angle);
-  float s = sin(angle);
+inline Mat4 m4_rotate_y(float angle) {
+  float s, c;
+  math_sincos(angle, &s, &c);
   return {
        c, 0.0f,   -s, 0.0f,
     0.0f, 1.0f, 0.0f, 0.0f,
@@ -208,9 +377,9 @@ static Mat4 m4_rotate_y(float angle) {
   };
 }
 
-static Mat4 m4_rotate_z(float angle) {
-  float c = cos(angle);
-  float s = sin(angle);
+inline Mat4 m4_rotate_z(float angle) {
+  float s, c;
+  math_sincos(angle, &s, &c);
   return {
        c,    s, 0.0f, 0.0f,
       -s,    c, 0.0f, 0.0f,
@@ -220,8 +389,25 @@ static Mat4 m4_rotate_z(float angle) {
 }
 
 // xyz rotation with gimbal lock....
-static Mat4 m4_rotate_yxz(Vec3 rotation) {
-  return m4_rotate_y(rotation.y) * m4_rotate_x(rotation.x) * m4_rotate_z(rotation.z);
+// m4_rotate_y(rotation.y) * m4_rotate_x(rotation.x) * m4_rotate_z(rotation.z) multiplied out by hand
+inline Mat4 m4_rotate_yxz(Vec3 rotation) {
+  float sx, cx, sy, cy, sz, cz;
+  math_sincos(rotation.x, &sx, &cx);
+  math_sincos(rotation.y, &sy, &cy);
+  math_sincos(rotation.z, &sz, &cz);
+
+  // the columns of y * x, then z turns the first two around the third
+  Vec3 a0 = {cy, 0, -sy},
+       a1 = {sx * sy, cx, sx * cy},
+       a2 = {cx * sy, -sx, cx * cy};
+  Vec3 c0 = a0 * cz + a1 * sz,
+       c1 = a1 * cz - a0 * sz;
+  return {
+    c0.x, c0.y, c0.z, 0.0f,
+    c1.x, c1.y, c1.z, 0.0f,
+    a2.x, a2.y, a2.z, 0.0f,
+    0.0f, 0.0f, 0.0f, 1.0f
+  };
 }
 
 inline Mat4 m4_lookat(Vec3 center, Vec3 eye, Vec3 up) {
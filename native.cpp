@@ -0,0 +1,195 @@
+// native host entry point, see native.sh. runs the game with no browser or GPU, so frame() can be
+// profiled with perf, valgrind or the sanitizers
+#include <stdio.h>
+
+#include "platform.h"
+#include "record.h"
+#include "platform_native.h"
+
+#define NATIVE_RECORD_PATH "session.rec"
+#define NATIVE_TRACE_PATH "trace.json"
+
+// shellsort, for percentiles
+static void native_sort(double *values, u32 count) {
+  for (u32 gap = count / 2; gap > 0; gap /= 2) {
+    for (u32 i = gap; i < count; ++i) {
+      double value = values[i];
+      u32 j = i;
+      for (; j >= gap && values[j - gap] > value; j -= gap) {
+        values[j] = values[j - gap];
+      }
+      values[j] = value;
+    }
+  }
+}
+
+// a made up session through the recorder, for when there's no real one: breaking the starting tree's leaves,
+// chopping and stacking its wood, then walking in circles looking around
+static bool native_record_session(const char *path) {
+  if (!native_record_open(path)) {
+    return false;
+  }
+
+  auto frames = [](int count) {
+    for (int i = 0; i < count; ++i) {
+      frame(1.0f / 60.0f);
+    }
+  };
+  auto hold = [&](const char *scancode, int count) {
+    keyhit(true, scancode);
+    frames(count);
+    keyhit(false, scancode);
+  };
+  auto click = [&](int button) {
+    mousehit(true, button);
+    mousehit(false, button);
+    frames(2);
+  };
+
+  init();
+  record_start();
+  resize(1280, 720);
+
+  hold("KeyS", 180);
+  mousemove(640, 360, 0, -60);
+  frames(2);
+  click(0);
+
+  mousemove(640, 360, 0, 60);
+  hold("KeyA", 18);
+  frames(2);
+  for (int i = 0; i < 20; ++i) {
+    click(0);
+  }
+  hold("Digit2", 1);
+  for (int i = 0; i < 10; ++i) {
+    click(2);
+  }
+
+  for (int i = 0; i < 20; ++i) {
+    keyhit(true, "KeyW");
+    for (int j = 0; j < 240; ++j) {
+      mousemove(640, 360, 4, j % 60 < 30 ? 1 : -1);
+      frames(1);
+    }
+    keyhit(false, "KeyW");
+  }
+
+  native_record_close();
+  return true;
+}
+
+/* replay: feeds a recording back into the exports, timing every frame */
+static void native_replay(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == nullptr) {
+    printf("can't open %s\n", path);
+    return;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  u8 *data = new u8[size];
+  size = fread(data, 1, size, file);
+  fclose(file);
+
+  RecordHeader header = {};
+  if (usize(size) >= sizeof(RecordHeader)) {
+    __builtin_memcpy(&header, data, sizeof(RecordHeader));
+  }
+  if (header.magic != RECORD_MAGIC || header.version != RECORD_VERSION) {
+    printf("%s isn't a version %d recording\n", path, RECORD_VERSION);
+    delete[] data;
+    return;
+  }
+
+  u32 event_count = (size - sizeof(RecordHeader)) / sizeof(RecordEvent);
+  double *frame_times = new double[event_count];
+  u32 frames = 0;
+  float game_time = 0;
+
+  // the recording starts right after init, from a new world
+  init();
+  native_counters = {};
+  for (u32 i = 0; i < event_count; ++i) {
+    RecordEvent event;
+    __builtin_memcpy(&event, data + sizeof(RecordHeader) + i * sizeof(RecordEvent), sizeof(RecordEvent));
+    switch (event.kind) {
+      case Record_Frame: {
+        double start = native_now();
+        frame(event.dt);
+        frame_times[frames++] = native_now() - start;
+        game_time += event.dt;
+      } break;
+      case Record_Key:
+        event.key.scancode[RECORD_SCANCODE_SIZE - 1] = '\0';
+        keyhit(event.key.down, event.key.scancode);
+        break;
+      case Record_MouseMove:
+        mousemove(event.move.x, event.move.y, event.move.dx, event.move.dy);
+        break;
+      case Record_MouseHit:
+        mousehit(event.hit.down, event.hit.button);
+        break;
+      case Record_Resize:
+        resize(event.resize.width, event.resize.height);
+        break;
+      case Record_Bind:
+        event.bind.scancode[RECORD_SCANCODE_SIZE - 1] = '\0';
+        if (input_action_name(event.bind.action) != nullptr) {
+          key_bind(event.bind.scancode, input_action_name(event.bind.action));
+        }
+        break;
+      default:
+        printf("unknown event %u at %u, stopping\n", event.kind, i);
+        i = event_count;
+        break;
+    }
+  }
+
+  if (frames == 0) {
+    printf("no frames in %s\n", path);
+  } else {
+    double total = 0;
+    for (u32 i = 0; i < frames; ++i) {
+      total += frame_times[i];
+    }
+    native_sort(frame_times, frames);
+    auto percentile = [&](double p) { return frame_times[u32(p * (frames - 1))] * 1e6; };
+
+    printf("%-8s %10s %10s %10s %10s %10s %10s\n", "frames", "game s", "mean us", "p50 us", "p90 us", "p99 us", "max us");
+    printf("%-8u %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+           frames, game_time, total / frames * 1e6, percentile(0.5), percentile(0.9), percentile(0.99),
+           frame_times[frames - 1] * 1e6);
+    NativeCounters *counters = &native_counters;
+    printf("per frame: %.1f render calls, %.0f verts, %.1f instanced draws, %.1f instance uploads\n",
+           counters->render_calls / double(frames), counters->render_verts / double(frames),
+           counters->instanced_draws / double(frames), counters->instance_uploads / double(frames));
+    // the same recording draws the same thing every time
+    printf("checksum %08x\n", counters->checksum);
+  }
+
+  delete[] frame_times;
+  delete[] data;
+}
+
+
+int main(int argc, char **argv) {
+  // native [recording], records a made up session first when not given one
+  const char *path = argc >= 2 ? argv[1] : NATIVE_RECORD_PATH;
+  if (argc < 2 && !native_record_session(path)) {
+    return 1;
+  }
+  native_replay(path);
+
+#ifdef PROFILE
+  // the last frames of the replay, open in chrome://tracing or ui.perfetto.dev
+  FILE *trace = fopen(NATIVE_TRACE_PATH, "w");
+  if (trace != nullptr) {
+    fputs(profile_trace(), trace);
+    fclose(trace);
+    printf("wrote %s\n", NATIVE_TRACE_PATH);
+  }
+#endif
+  return 0;
+}
@@ -0,0 +1,14 @@
+# native host: ./native.sh [recording], replays a recording (see record.h) and times every frame.
+# extra flags go through CXXFLAGS, e.g. CXXFLAGS="-fsanitize=address,undefined" ./native.sh,
+# or run build/native under perf or valgrind. CXXFLAGS=-DPROFILE also writes the profiler's zones to trace.json
+mkdir -p build
+cd build
+
+${CXX:-zig c++} \
+  -O2 \
+  -g \
+  -std=c++20 \
+  $CXXFLAGS \
+  -o native \
+  ../native.cpp ../platform_native.cpp ../main.cpp ../platform.cpp ../gen.cpp ../log.cpp ../profile.cpp \
+  && ./native "$@"
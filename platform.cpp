@@ -20,3 +20,70 @@ PLATFORM_EXPORT void setstack(void* at) {
 
     intern_stack_len = (u8*)at-intern_stack;
 }
+
+#ifdef __wasm__
+void *mem_pages(usize size) {
+    usize pages = (size + 0xffff) >> 16;
+    usize old = __builtin_wasm_memory_grow(0, pages);
+    if (old == usize(-1)) {
+        return nullptr;
+    }
+    return (void *)(old << 16);
+}
+#endif
+
+#define MEM_MIN_BLOCK 64
+#define MEM_SIZE_CLASSES 26
+#define MEM_REGION_SIZE (1 << 20)
+
+// freed blocks of each size class, linked through their first word
+static void *mem_free_blocks[MEM_SIZE_CLASSES];
+static u8 *mem_region = nullptr;
+static usize mem_region_left = 0;
+
+static u32 mem_size_class(usize size) {
+    u32 size_class = 0;
+    while ((usize(MEM_MIN_BLOCK) << size_class) < size) {
+        size_class++;
+    }
+    return size_class;
+}
+
+void *mem_alloc(usize size) {
+    u32 size_class = mem_size_class(size);
+    if (size_class >= MEM_SIZE_CLASSES) {
+        return nullptr;
+    }
+
+    if (mem_free_blocks[size_class] != nullptr) {
+        void *block = mem_free_blocks[size_class];
+        mem_free_blocks[size_class] = *(void **)block;
+        return block;
+    }
+
+    usize block_size = usize(MEM_MIN_BLOCK) << size_class;
+    if (block_size > mem_region_left) {
+        // whatever is left of the old region is lost, at most MEM_REGION_SIZE
+        usize region_size = block_size > MEM_REGION_SIZE ? block_size : MEM_REGION_SIZE;
+        mem_region = (u8 *)mem_pages(region_size);
+        if (mem_region == nullptr) {
+            mem_region_left = 0;
+            return nullptr;
+        }
+        mem_region_left = region_size;
+    }
+
+    void *block = mem_region;
+    mem_region += block_size;
+    mem_region_left -= block_size;
+    return block;
+}
+
+void mem_free(void *ptr, usize size) {
+    if (ptr == nullptr) {
+        return;
+    }
+    u32 size_class = mem_size_class(size);
+    *(void **)ptr = mem_free_blocks[size_class];
+    mem_free_blocks[size_class] = ptr;
+}
@@ -16,6 +16,10 @@ static_assert(sizeof(int) == 4, "sizeof(int) != 4");
 typedef int i32;
 typedef unsigned int u32;
 
+static_assert(sizeof(long long) == 8, "sizeof(long long) != 8");
+typedef long long i64;
+typedef unsigned long long u64;
+
 typedef u32 usize;
 typedef i32 isize;
 // </WASM ONLY>
@@ -33,16 +37,34 @@ struct __attribute__((packed)) Vert {
   float color;
 }; 
 
+/* one copy of a mesh in an instanced draw, 17 floats */
+struct Instance {
+  Mat4 model;
+  float color;
+};
+static_assert(sizeof(Instance) == 17 * sizeof(float), "Instance is padded");
+
 /* this is needed for interop of strings between JS and C++ */
 /* this is a temporary bump allocator, so upon calling setstack you might free something you didn't want to, so be careful! */
 PLATFORM_EXPORT void* getstack(usize n);
 PLATFORM_EXPORT void setstack(void* at);
 
+/* memory */
+/* hands out a fresh block of at least `size` bytes, or nullptr when out of memory.
+ * implemented by the host: memory.grow on wasm (platform.cpp), natively by whatever links the game */
+void *mem_pages(usize size);
+
+/* general purpose allocator on top of mem_pages. blocks are rounded up to a power of two and
+ * recycled through mem_free, which needs the same size that was passed to mem_alloc */
+void *mem_alloc(usize size);
+void mem_free(void *ptr, usize size);
+
 PLATFORM_EXPORT void init(void);
 
 /* events */
 PLATFORM_EXPORT void frame(float dt); // expected to call `render`
 PLATFORM_EXPORT void keyhit(bool down, const char *scancode);
+PLATFORM_EXPORT bool key_bind(const char *scancode, const char *action); // "None" unbinds, false if either is unknown
 PLATFORM_EXPORT void resize(int width, int height);
 
 /* down = was pressed or released
@@ -52,12 +74,65 @@ PLATFORM_EXPORT void resize(int width, int height);
 PLATFORM_EXPORT void mousehit(bool down, int button);
 PLATFORM_EXPORT void mousemove(int x, int y, int dx, int dy);
 
+/* input ring: instead of calling the exports above for every event, the host can queue them here and the
+ * game runs them at the top of the next frame. the host writes the event at `write` and then bumps it,
+ * leaving the ring alone when `write - read` is INPUT_RING_SIZE. both only ever go up, wrapping around.
+ * a mouse move may be added onto the move before it, as long as the game hasn't read that one yet.
+ * keys are the index of their scancode, input_scancode_name gives the scancode for every index from 1 up
+ * until it returns nullptr */
+#define INPUT_RING_SIZE 256
+
+enum InputKind {
+  Input_Key = 1,
+  Input_MouseHit,
+  Input_MouseMove,
+};
+
+struct InputEvent {
+  u32 kind;
+  union {
+    struct {
+      i32 code, down;
+    } key;
+    struct {
+      i32 button, down;
+    } hit;
+    struct {
+      i32 x, y, dx, dy;
+    } move;
+  };
+};
+static_assert(sizeof(InputEvent) == 5 * sizeof(u32), "InputEvent is padded");
+
+struct InputRing {
+  u32 read, write;
+  InputEvent events[INPUT_RING_SIZE];
+};
+
+PLATFORM_EXPORT InputRing *input_ring(void);
+PLATFORM_EXPORT const char *input_scancode_name(int code);
+PLATFORM_EXPORT const char *input_action_name(int action); // the same for actions, for key_bind
+
 PLATFORM_IMPORT void render(
   u16  *indexes, int index_count,
   Vert *verts,   int vert_count,
   Mat4  mvp
 );
 
+/* retained meshes and instance buffers: the host copies the data once and keeps it under `id`
+ * until the same id is uploaded again. ids are small and handed out from 0 up, meshes and
+ * instance buffers have separate ids */
+PLATFORM_IMPORT void mesh_upload(
+  int id,
+  u16  *indexes, int index_count,
+  Vert *verts,   int vert_count
+);
+PLATFORM_IMPORT void instances_upload(int id, Instance *instances, int instance_count);
+
+/* draws mesh `mesh_id` once for every instance in `instances_id`, the normals of the mesh are
+ * transformed by each instance's model */
+PLATFORM_IMPORT void mesh_draw_instanced(int mesh_id, int instances_id, Mat4 vp);
+
 enum SelectKey {
   SelectKey_DepthTest = 0,
 };
@@ -66,5 +141,35 @@ PLATFORM_IMPORT void select(
   int select_key, bool value
 );
 
-PLATFORM_IMPORT void console_log_n(const char *string, usize strlen);
+/* chunk store: keeps the parts of the world that are out of range, in the save file laid out in save.h.
+ * chunk_load asks for a chunk's snapshot objects. the host answers with chunk_loaded whenever it's ready, which
+ * may be from inside chunk_load, with size 0 if it has nothing. the data can be put in chunk_buffer first.
+ * save_load asks for the header followed by the edit log, answered with save_loaded from inside save_load,
+ * size 0 for a new world. save_append adds edits to the end of the log.
+ * save_compact asks for the snapshot, the file without its edit log, answered with save_snapshot_loaded from
+ * inside save_compact, size 0 if there's no file. the game bakes its log into it and hands the new file to
+ * save_write, which replaces the old one, log and all, and returns false if it couldn't */
+PLATFORM_IMPORT void chunk_load(int x, int z);
+PLATFORM_EXPORT void *chunk_buffer(usize size);
+PLATFORM_EXPORT void chunk_loaded(int x, int z, const u8 *data, usize size);
+PLATFORM_IMPORT void save_load();
+PLATFORM_EXPORT void save_loaded(const u8 *data, usize size);
+PLATFORM_IMPORT void save_append(const u8 *data, usize size);
+PLATFORM_IMPORT void save_compact();
+PLATFORM_EXPORT void save_snapshot_loaded(const u8 *data, usize size);
+PLATFORM_IMPORT bool save_write(const u8 *data, usize size);
+
+/* input recording: from record_start on, every call to the events above is passed to record_append in the
+ * layout from record.h, in order, by the end of the frame it came in for at the latest */
+PLATFORM_EXPORT void record_start(void);
+PLATFORM_IMPORT void record_append(const u8 *data, usize size);
+
+/* profiling, see profile.h. time_now is seconds from any fixed point, at the best resolution the host has.
+ * profile_trace returns the frames still in the profiler as chrome trace event json, zero terminated */
+PLATFORM_IMPORT double time_now(void);
+PLATFORM_EXPORT const char *profile_trace(void);
+
+/* logging, see log.h. once a frame at most, `entries` are "W Chunk: text\0" one after another, the first
+ * letter is the level: D(ebug), I(nfo), W(arn) or E(rror) */
+PLATFORM_IMPORT void console_log_batch(const char *entries, usize size);
 #endif
\ No newline at end of file
@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "platform_native.h"
+
+NativeCounters native_counters;
+
+static void checksum_matrix(Mat4 m) {
+    const u8 *bytes = (const u8 *)&m;
+    for (usize i = 0; i < sizeof(Mat4); ++i) {
+        native_counters.checksum = (native_counters.checksum ^ bytes[i]) * 16777619u;
+    }
+}
+
+PLATFORM_IMPORT void render(u16 *, int index_count, Vert *, int vert_count, Mat4 mvp) {
+    native_counters.render_calls++;
+    native_counters.render_indexes += index_count;
+    native_counters.render_verts += vert_count;
+    checksum_matrix(mvp);
+}
+
+PLATFORM_IMPORT void mesh_upload(int, u16 *, int, Vert *, int) {
+    native_counters.mesh_uploads++;
+}
+
+PLATFORM_IMPORT void instances_upload(int, Instance *, int instance_count) {
+    native_counters.instance_uploads++;
+    native_counters.instances_uploaded += instance_count;
+}
+
+PLATFORM_IMPORT void mesh_draw_instanced(int, int, Mat4 vp) {
+    native_counters.instanced_draws++;
+    checksum_matrix(vp);
+}
+
+PLATFORM_IMPORT void select(int, bool) {
+    native_counters.selects++;
+}
+
+PLATFORM_IMPORT void console_log_batch(const char *entries, usize size) {
+    for (const char *entry = entries; entry < entries + size; entry += __builtin_strlen(entry) + 1) {
+        printf("%s\n", entry);
+    }
+}
+
+void *mem_pages(usize size) {
+    return new u8[size];
+}
+
+double native_now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+PLATFORM_IMPORT double time_now(void) {
+    return native_now();
+}
+
+NativeSave native_save;
+
+void native_save_close() {
+    if (native_save.map != nullptr) {
+        munmap((void *)native_save.map, native_save.map_size);
+    }
+    if (native_save.fd >= 0) {
+        close(native_save.fd);
+    }
+    native_save = {};
+}
+
+// no parsing, just checks the header and that the index and objects fit in the file
+bool native_save_open(const char *path) {
+    native_save_close();
+
+    int fd = open(path, O_RDWR | O_APPEND);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || usize(st.st_size) < sizeof(SaveHeader)) {
+        printf("can't open save %s\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        printf("can't map save %s\n", path);
+        close(fd);
+        return false;
+    }
+
+    native_save.fd = fd;
+    native_save.path = path;
+    native_save.map = (const u8 *)map;
+    native_save.map_size = st.st_size;
+    __builtin_memcpy(&native_save.header, map, sizeof(SaveHeader));
+
+    SaveHeader *header = &native_save.header;
+    size_t log_start = sizeof(SaveHeader) + size_t(header->chunk_count) * sizeof(SaveChunk) +
+                       size_t(header->object_count) * sizeof(SaveObject);
+    if (header->magic != SAVE_MAGIC || header->version != SAVE_VERSION || log_start > native_save.map_size) {
+        printf("%s isn't a version %d save\n", path, SAVE_VERSION);
+        native_save_close();
+        return false;
+    }
+
+    native_save.chunks = (const SaveChunk *)(native_save.map + sizeof(SaveHeader));
+    native_save.objects = (const SaveObject *)(native_save.chunks + header->chunk_count);
+    native_save.log_start = log_start;
+    return true;
+}
+
+bool native_save_write_snapshot(const char *path, SaveInventory inventory,
+                                const SaveChunk *chunks, u32 chunk_count,
+                                const SaveObject *objects, u32 object_count) {
+    FILE *file = fopen(path, "wb");
+    if (file == nullptr) {
+        printf("can't write save %s\n", path);
+        return false;
+    }
+
+    SaveHeader header = {SAVE_MAGIC, SAVE_VERSION, chunk_count, object_count, inventory};
+    fwrite(&header, sizeof(SaveHeader), 1, file);
+    fwrite(chunks, sizeof(SaveChunk), chunk_count, file);
+    fwrite(objects, sizeof(SaveObject), object_count, file);
+    fclose(file);
+    return true;
+}
+
+const SaveChunk *native_save_find(int x, int z) {
+    const SaveChunk *chunks = native_save.chunks;
+    u32 lo = 0, hi = native_save.fd >= 0 ? native_save.header.chunk_count : 0;
+    while (lo < hi) {
+        u32 mid = lo + (hi - lo) / 2;
+        if (chunks[mid].x < x || (chunks[mid].x == x && chunks[mid].z < z)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (native_save.fd >= 0 && lo < native_save.header.chunk_count && chunks[lo].x == x && chunks[lo].z == z) {
+        return &chunks[lo];
+    }
+    return nullptr;
+}
+
+// answers right away, the objects are already in memory as far as the game can tell
+PLATFORM_IMPORT void chunk_load(int x, int z) {
+    native_counters.chunk_loads++;
+    const SaveChunk *chunk = native_save_find(x, z);
+    if (chunk == nullptr || chunk->first + size_t(chunk->count) > native_save.header.object_count) {
+        chunk_loaded(x, z, nullptr, 0);
+        return;
+    }
+
+    native_counters.chunk_bytes_loaded += chunk->count * sizeof(SaveObject);
+    chunk_loaded(x, z, (const u8 *)(native_save.objects + chunk->first), chunk->count * sizeof(SaveObject));
+}
+
+// the edits aren't in the mapping, they may have been appended after it was made
+PLATFORM_IMPORT void save_load() {
+    struct stat st;
+    if (native_save.fd < 0 || fstat(native_save.fd, &st) != 0) {
+        save_loaded(nullptr, 0);
+        return;
+    }
+
+    usize log_size = usize(st.st_size) - native_save.log_start;
+    u8 *data = (u8 *)chunk_buffer(sizeof(SaveHeader) + log_size);
+    __builtin_memcpy(data, &native_save.header, sizeof(SaveHeader));
+    ssize_t read = pread(native_save.fd, data + sizeof(SaveHeader), log_size, native_save.log_start);
+    save_loaded(data, sizeof(SaveHeader) + (read > 0 ? read : 0));
+}
+
+PLATFORM_IMPORT void save_append(const u8 *data, usize size) {
+    if (native_save.fd < 0) {
+        return;
+    }
+    if (write(native_save.fd, data, size) != ssize_t(size)) {
+        printf("save append failed\n");
+    }
+    native_counters.save_bytes_appended += size;
+}
+
+// the snapshot is all of the mapping up to the log
+PLATFORM_IMPORT void save_compact() {
+    if (native_save.fd < 0) {
+        save_snapshot_loaded(nullptr, 0);
+        return;
+    }
+    save_snapshot_loaded(native_save.map, native_save.log_start);
+}
+
+// written beside the old file and renamed over it, so a crash leaves one or the other
+PLATFORM_IMPORT bool save_write(const u8 *data, usize size) {
+    if (native_save.fd < 0) {
+        return false;
+    }
+    const char *path = native_save.path;
+    char temp[4096];
+    snprintf(temp, sizeof temp, "%s.new", path);
+
+    FILE *file = fopen(temp, "wb");
+    bool ok = file != nullptr && fwrite(data, 1, size, file) == size;
+    if (file != nullptr) {
+        ok = fclose(file) == 0 && ok;
+    }
+    if (!ok || rename(temp, path) != 0) {
+        printf("can't write save %s\n", path);
+        return false;
+    }
+    native_counters.save_bytes_written += size;
+    return native_save_open(path);
+}
+
+static FILE *record_file = nullptr;
+
+bool native_record_open(const char *path) {
+    native_record_close();
+    record_file = fopen(path, "wb");
+    if (record_file == nullptr) {
+        printf("can't write %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+void native_record_close() {
+    if (record_file != nullptr) {
+        fclose(record_file);
+        record_file = nullptr;
+    }
+}
+
+PLATFORM_IMPORT void record_append(const u8 *data, usize size) {
+    if (record_file != nullptr) {
+        fwrite(data, 1, size, record_file);
+        native_counters.record_bytes += size;
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef PLATFORM_NATIVE_H
+#define PLATFORM_NATIVE_H
+
+#include "platform.h"
+#include "save.h"
+
+/* native host, the counterpart of main.html for running the game on Linux (see native.sh).
+ * nothing is drawn, the imports count what they are handed */
+struct NativeCounters {
+    u32 render_calls, render_indexes, render_verts;
+    u32 mesh_uploads, instance_uploads, instances_uploaded;
+    u32 instanced_draws;
+    u32 selects;
+    u32 chunk_loads;
+    usize chunk_bytes_loaded, save_bytes_appended, save_bytes_written, record_bytes;
+    u32 checksum; // of every matrix passed to render and mesh_draw_instanced, same input gives the same one
+};
+
+extern NativeCounters native_counters;
+
+/* save store: the snapshot part of the save file is mapped and used in place, chunk_load hands the game
+ * pointers straight into the mapping. edits go on the end of the file, compacting writes a new file next to
+ * it and renames it over. with no save open, every chunk is empty and save_load starts a new world */
+struct NativeSave {
+    int fd = -1; // -1 while none is open
+    const char *path; // as given to native_save_open, save_write replaces the file there
+    const u8 *map;
+    usize map_size;
+    SaveHeader header;
+    const SaveChunk *chunks;
+    const SaveObject *objects;
+    usize log_start;
+};
+
+extern NativeSave native_save;
+
+bool native_save_open(const char *path);
+void native_save_close();
+// `chunks` sorted by x then z, `objects` grouped in the same order
+bool native_save_write_snapshot(const char *path, SaveInventory inventory,
+                                const SaveChunk *chunks, u32 chunk_count,
+                                const SaveObject *objects, u32 object_count);
+const SaveChunk *native_save_find(int x, int z);
+
+/* record_append writes to this file while it's open */
+bool native_record_open(const char *path);
+void native_record_close();
+
+double native_now(); // seconds, monotonic
+
+#endif
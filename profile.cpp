@@ -0,0 +1,159 @@
+#include "profile.h"
+
+#ifdef PROFILE
+
+Profiler profiler;
+
+static ProfileFrame *profile_current() {
+  if (profiler.frame_count == 0) {
+    profile_frame();
+  }
+  return &profiler.frames[(profiler.frame_count - 1) % PROFILE_FRAMES];
+}
+
+void profile_frame() {
+  double now = time_now();
+  if (profiler.frame_count != 0) {
+    ProfileFrame *frame = &profiler.frames[(profiler.frame_count - 1) % PROFILE_FRAMES];
+    frame->duration = float((now - frame->start) * 1e6);
+  }
+
+  ProfileFrame *frame = &profiler.frames[profiler.frame_count++ % PROFILE_FRAMES];
+  frame->start = now;
+  frame->duration = 0;
+  frame->zone_count = 0;
+  frame->dropped = 0;
+  // zones still open carry on into the new frame as dropped ones
+  for (u32 i = 0; i < profiler.depth && i < PROFILE_MAX_DEPTH; ++i) {
+    profiler.open[i] = PROFILE_NONE;
+  }
+  for (u32 i = 0; i <= PROFILE_MAX_DEPTH; ++i) {
+    profiler.last[i] = PROFILE_NONE;
+  }
+}
+
+void profile_begin(const char *name) {
+  ProfileFrame *frame = profile_current();
+  u32 depth = profiler.depth++;
+  if (depth >= PROFILE_MAX_DEPTH) {
+    frame->dropped++;
+    return;
+  }
+
+  double now = time_now();
+  u16 parent = depth == 0 ? u16(PROFILE_NONE) : profiler.open[depth - 1];
+  u16 last = profiler.last[depth];
+  u16 index;
+  if (last != PROFILE_NONE && frame->zones[last].name == name && frame->zones[last].parent == parent) {
+    index = last;
+  } else if (frame->zone_count < PROFILE_ZONES_PER_FRAME && (depth == 0 || parent != PROFILE_NONE)) {
+    index = frame->zone_count++;
+    frame->zones[index] = {name, float((now - frame->start) * 1e6), 0, 0, u16(depth), parent};
+  } else {
+    index = PROFILE_NONE;
+    frame->dropped++;
+  }
+
+  profiler.open[depth] = index;
+  profiler.open_start[depth] = now;
+  profiler.last[depth + 1] = PROFILE_NONE;
+}
+
+void profile_end() {
+  u32 depth = --profiler.depth;
+  if (depth >= PROFILE_MAX_DEPTH || profiler.open[depth] == PROFILE_NONE) {
+    return;
+  }
+
+  ProfileZoneTime *zone = &profile_current()->zones[profiler.open[depth]];
+  zone->total += float((time_now() - profiler.open_start[depth]) * 1e6);
+  zone->calls++;
+  profiler.last[depth] = profiler.open[depth];
+}
+
+ProfileFrame *profile_last_frame() {
+  if (profiler.frame_count < 2) {
+    return nullptr;
+  }
+  return &profiler.frames[(profiler.frame_count - 2) % PROFILE_FRAMES];
+}
+
+static char *trace = nullptr;
+static usize trace_capacity = 0, trace_length = 0;
+
+static void trace_put(const char *s) {
+  while (*s && trace_length + 1 < trace_capacity) {
+    trace[trace_length++] = *s++;
+  }
+}
+
+static void trace_put_u32(u32 value, int min_digits = 1) {
+  char digits[10];
+  int count = 0;
+  do {
+    digits[count++] = '0' + value % 10;
+    value /= 10;
+  } while (value != 0 || count < min_digits);
+  char out[11];
+  for (int i = 0; i < count; ++i) {
+    out[i] = digits[count - 1 - i];
+  }
+  out[count] = '\0';
+  trace_put(out);
+}
+
+// microseconds to the nanosecond, which is as fine as the trace viewer goes
+static void trace_put_us(double us) {
+  u32 whole = u32(us);
+  trace_put_u32(whole);
+  trace_put(".");
+  trace_put_u32(u32((us - whole) * 1000.0), 3);
+}
+
+// chrome://tracing / perfetto json, one complete event per zone. merged calls become one event as long
+// as all of them together, starting at the first call
+PLATFORM_EXPORT const char *profile_trace(void) {
+  usize capacity = PROFILE_FRAMES * PROFILE_ZONES_PER_FRAME * 160 + 64;
+  if (trace_capacity < capacity) {
+    if (trace != nullptr) {
+      mem_free(trace, trace_capacity);
+    }
+    trace = (char *)mem_alloc(capacity);
+    trace_capacity = trace == nullptr ? 0 : capacity;
+    if (trace == nullptr) {
+      return "";
+    }
+  }
+
+  trace_length = 0;
+  trace_put("{\"traceEvents\": [");
+  bool first = true;
+  double origin = 0;
+  u32 finished = profiler.frame_count == 0 ? 0 : profiler.frame_count - 1;
+  u32 oldest = finished > PROFILE_FRAMES - 1 ? finished - (PROFILE_FRAMES - 1) : 0;
+  for (u32 f = oldest; f < finished; ++f) {
+    ProfileFrame *frame = &profiler.frames[f % PROFILE_FRAMES];
+    if (f == oldest) {
+      origin = frame->start;
+    }
+    double frame_start = (frame->start - origin) * 1e6;
+    for (u32 i = 0; i < frame->zone_count; ++i) {
+      ProfileZoneTime *zone = &frame->zones[i];
+      trace_put(first ? "\n{\"name\": \"" : ",\n{\"name\": \"");
+      first = false;
+      trace_put(zone->name);
+      trace_put("\", \"ph\": \"X\", \"pid\": 0, \"tid\": 0, \"ts\": ");
+      trace_put_us(frame_start + zone->start);
+      trace_put(", \"dur\": ");
+      trace_put_us(zone->total);
+      trace_put(", \"args\": {\"calls\": ");
+      trace_put_u32(zone->calls);
+      trace_put("}}");
+    }
+  }
+  trace_put("\n]}\n");
+  trace[trace_length] = '\0';
+  return trace;
+}
+
+#endif
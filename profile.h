@@ -0,0 +1,68 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "platform.h"
+
+/* scoped cpu profiling zones, only built with -DPROFILE. without it the macros are empty.
+ *   PROFILE_FRAME();      at the top of a frame, moves on to the next one in the ring
+ *   PROFILE_ZONE("name"); times the rest of the enclosing scope, names are string literals
+ * zones nest. a zone entered again right after it ended at the same place, like once per loop iteration,
+ * counts as another call of the same zone, so a frame only holds a handful of them */
+#ifdef PROFILE
+
+#define PROFILE_FRAMES 64
+#define PROFILE_ZONES_PER_FRAME 128
+#define PROFILE_MAX_DEPTH 16
+#define PROFILE_NONE 0xffff
+
+struct ProfileZoneTime {
+  const char *name;
+  float start; // us from the start of the frame, first call
+  float total; // us inside, all calls
+  u32 calls;
+  u16 depth;
+  u16 parent; // zone index, PROFILE_NONE at the top
+};
+
+struct ProfileFrame {
+  double start; // time_now
+  float duration; // us, 0 while it's the current one
+  ProfileZoneTime zones[PROFILE_ZONES_PER_FRAME];
+  u32 zone_count;
+  u32 dropped; // didn't fit
+};
+
+struct Profiler {
+  ProfileFrame frames[PROFILE_FRAMES]; // ring
+  u32 frame_count; // started so far, the current one is frame_count - 1
+  u32 depth;
+  u16 open[PROFILE_MAX_DEPTH]; // zone index per depth, PROFILE_NONE if it was dropped
+  u16 last[PROFILE_MAX_DEPTH + 1]; // last zone that ended at each depth, for merging calls
+  double open_start[PROFILE_MAX_DEPTH];
+};
+
+extern Profiler profiler;
+
+void profile_frame();
+void profile_begin(const char *name);
+void profile_end();
+ProfileFrame *profile_last_frame(); // the last finished one, nullptr before there is one
+
+struct ProfileScope {
+  ProfileScope(const char *name) { profile_begin(name); }
+  ~ProfileScope() { profile_end(); }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#define PROFILE_FRAME() profile_frame()
+
+#else
+
+#define PROFILE_ZONE(name)
+#define PROFILE_FRAME()
+
+#endif
+
+#endif
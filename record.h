@@ -0,0 +1,56 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include "platform.h"
+
+/* input recording, as handed to record_append. little-endian like the save:
+ *   RecordHeader
+ *   RecordEvent...  in the order the exports were called
+ * feeding the events back into the same exports replays the session, see bench.cpp */
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "recordings are little-endian");
+
+#define RECORD_MAGIC 0x43455257 // "WREC"
+#define RECORD_VERSION 2 // 2: key binds are recorded
+
+struct RecordHeader {
+  u32 magic, version;
+};
+
+enum RecordKind {
+  Record_Frame = 1,
+  Record_Key,
+  Record_MouseMove,
+  Record_MouseHit,
+  Record_Resize,
+  Record_Bind, // key_bind, and the bindings that weren't the defaults when recording started
+};
+
+#define RECORD_SCANCODE_SIZE 20 // longer scancodes are cut short, none of the bound ones are
+
+struct RecordEvent {
+  u32 kind;
+  float time; // game time when it came in, in seconds
+  union {
+    float dt;
+    struct {
+      i32 down;
+      char scancode[RECORD_SCANCODE_SIZE]; // zero terminated
+    } key;
+    struct {
+      i32 x, y, dx, dy;
+    } move;
+    struct {
+      i32 down, button;
+    } hit;
+    struct {
+      i32 width, height;
+    } resize;
+    struct {
+      char scancode[RECORD_SCANCODE_SIZE]; // zero terminated
+      i32 action; // index into action_names, input_action_name gives the name
+    } bind;
+  };
+};
+static_assert(sizeof(RecordEvent) == 32, "RecordEvent is padded");
+
+#endif
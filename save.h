@@ -0,0 +1,71 @@
+#ifndef SAVE_H
+#define SAVE_H
+
+#include "platform.h"
+
+/* world save file. little-endian, every field 4 byte aligned, so a host can map the file and hand out
+ * pointers into it as they are. laid out as:
+ *   SaveHeader
+ *   SaveChunk[chunk_count]   sorted by x, then z
+ *   SaveObject[object_count] grouped by chunk, in the same order
+ *   SaveEdit...              appended since the snapshot was written, up to the end of the file
+ * a chunk's objects are what chunk_loaded gets, the header and the edits are what save_loaded gets */
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "saves are little-endian");
+
+#define SAVE_MAGIC 0x56415357 // "WSAV"
+#define SAVE_VERSION 1
+
+struct SaveObject {
+  float pos[3], rot[3], scale[3];
+  u8 shape, drop;
+  u8 unbreakable;
+  u8 pad;
+};
+static_assert(sizeof(SaveObject) == 40, "SaveObject is padded");
+
+struct SaveInventory {
+  u32 selection;
+  struct {
+    u32 item_type, item_count;
+  } items[2];
+};
+static_assert(sizeof(SaveInventory) == 20, "SaveInventory is padded");
+
+struct SaveHeader {
+  u32 magic, version;
+  u32 chunk_count, object_count;
+  SaveInventory inventory;
+};
+static_assert(sizeof(SaveHeader) == 36, "SaveHeader is padded");
+
+struct SaveChunk {
+  i32 x, z;
+  u32 first, count; // range in the objects
+};
+static_assert(sizeof(SaveChunk) == 16, "SaveChunk is padded");
+
+// the sizes and offsets above for a host that doesn't have this header, from save_layout
+struct SaveLayout {
+  u32 header_size, chunk_size, object_size, edit_size;
+  u32 chunk_count_at, object_count_at; // in the header
+  u32 x_at, z_at, first_at, count_at; // in a chunk
+};
+
+PLATFORM_EXPORT const SaveLayout *save_layout(void);
+
+enum SaveEditKind {
+  SaveEdit_Place = 1,
+  SaveEdit_Remove, // the first object in the world that matches
+  SaveEdit_Inventory,
+};
+
+struct SaveEdit {
+  u32 kind;
+  union {
+    SaveObject object;
+    SaveInventory inventory;
+  };
+};
+static_assert(sizeof(SaveEdit) == 44, "SaveEdit is padded");
+
+#endif
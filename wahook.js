@@ -12,6 +12,14 @@ class Buffer {
   }
 }
 
+class InstanceBuffer {
+  constructor(vb, count) {
+    this.vb = vb
+    this.count = count
+    this.data = null // a copy of the instances, only kept without ANGLE_instanced_arrays
+  }
+}
+
 class Attrib {
   constructor(name, size) {
     this.name = name
@@ -33,8 +41,13 @@ class Renderer {
     }
 
     this.gl_ex_lose_context = gl.getExtension("WEBGL_lose_context")
+    this.gl_ex_instanced = gl.getExtension("ANGLE_instanced_arrays")
     this.gl = gl
 
+    if (!this.gl_ex_instanced) {
+      console.warn("ANGLE_instanced_arrays is not supported, instanced draws go one draw call per instance");
+    }
+
     gl.enable(gl.DEPTH_TEST);
     gl.enable(gl.CULL_FACE);
     gl.frontFace(gl.CW);
@@ -88,23 +101,51 @@ class Renderer {
     return new Shader(program);
   }
 
-  updateBuffer(buffer, vertices, indices) {
+  updateBuffer(buffer, vertices, indices, usage = this.gl.DYNAMIC_DRAW) {
     this.gl.bindBuffer(this.gl.ARRAY_BUFFER, buffer.vb);
-    this.gl.bufferData(this.gl.ARRAY_BUFFER, vertices, this.gl.DYNAMIC_DRAW);
+    this.gl.bufferData(this.gl.ARRAY_BUFFER, vertices, usage);
 
     this.gl.bindBuffer(this.gl.ELEMENT_ARRAY_BUFFER, buffer.ib);
-    this.gl.bufferData(this.gl.ELEMENT_ARRAY_BUFFER, indices, this.gl.DYNAMIC_DRAW);
+    this.gl.bufferData(this.gl.ELEMENT_ARRAY_BUFFER, indices, usage);
 
     buffer.indexCount = indices.length;
   }
 
-  createBuffer(vertices, indices) {
+  createBuffer(vertices, indices, usage = this.gl.DYNAMIC_DRAW) {
     let buf = new Buffer(this.gl.createBuffer(), this.gl.createBuffer(), indices.length)
-    this.updateBuffer(buf, vertices, indices)
+    this.updateBuffer(buf, vertices, indices, usage)
+    return buf
+  }
+
+  updateInstanceBuffer(buffer, instances, count, usage = this.gl.DYNAMIC_DRAW) {
+    this.gl.bindBuffer(this.gl.ARRAY_BUFFER, buffer.vb);
+    this.gl.bufferData(this.gl.ARRAY_BUFFER, instances, usage);
+
+    buffer.count = count;
+    // the fallback in drawInstanced reads them back on the CPU, `instances` may not outlive this call
+    buffer.data = this.gl_ex_instanced ? null : instances.slice();
+  }
+
+  createInstanceBuffer(instances, count, usage = this.gl.DYNAMIC_DRAW) {
+    let buf = new InstanceBuffer(this.gl.createBuffer(), count)
+    this.updateInstanceBuffer(buf, instances, count, usage)
     return buf
   }
 
+  // attrib pointers remember the buffer bound when they're set, so draw sets them again for its buffer
   vertexAttribFloatDesc(shader, attribs) {
+    shader.attribs = attribs;
+    this.attribPointers(shader, attribs, 0);
+  }
+
+  // like vertexAttribFloatDesc, for the attribs that come from an InstanceBuffer in drawInstanced
+  instanceAttribFloatDesc(shader, attribs) {
+    shader.instanceAttribs = attribs;
+  }
+
+  // points `attribs` at the bound array buffer, advancing once per vertex (divisor 0) or per instance (1).
+  // returns the locations it enabled
+  attribPointers(shader, attribs, divisor) {
     let vertexSize = 0;
 
     for (let i in attribs) {
@@ -112,13 +153,23 @@ class Renderer {
     }
 
     let offset = 0;
+    let locations = [];
 
     for (let i in attribs) {
       let location = this.gl.getAttribLocation(shader.program, attribs[i].name);
-      this.gl.vertexAttribPointer(location, attribs[i].size, this.gl.FLOAT, false, vertexSize * Float32Array.BYTES_PER_ELEMENT, offset);
-      this.gl.enableVertexAttribArray(location);
+      // the shader might not use every attrib in the buffer
+      if (location >= 0) {
+        this.gl.vertexAttribPointer(location, attribs[i].size, this.gl.FLOAT, false, vertexSize * Float32Array.BYTES_PER_ELEMENT, offset);
+        this.gl.enableVertexAttribArray(location);
+        if (this.gl_ex_instanced) {
+          this.gl_ex_instanced.vertexAttribDivisorANGLE(location, divisor);
+        }
+        locations.push(location);
+      }
       offset += attribs[i].size * Float32Array.BYTES_PER_ELEMENT;
     }
+
+    return locations;
   }
 
   setUniformMatrix4fv(shader, name, value) {
@@ -127,9 +178,68 @@ class Renderer {
   }
 
   draw(shader, buffer) {
+    if (buffer.indexCount == 0) {
+      return;
+    }
+
     this.gl.bindBuffer(this.gl.ARRAY_BUFFER, buffer.vb);
     this.gl.bindBuffer(this.gl.ELEMENT_ARRAY_BUFFER, buffer.ib);
+    this.vertexAttribFloatDesc(shader, shader.attribs);
     this.gl.useProgram(shader.program);
     this.gl.drawElements(this.gl.TRIANGLES, buffer.indexCount, this.gl.UNSIGNED_SHORT, 0);
   }
+
+  drawInstanced(shader, buffer, instances) {
+    if (buffer.indexCount == 0 || instances.count == 0) {
+      return;
+    }
+    if (!this.gl_ex_instanced) {
+      this.drawInstancedFallback(shader, buffer, instances);
+      return;
+    }
+
+    this.gl.useProgram(shader.program);
+    this.gl.bindBuffer(this.gl.ARRAY_BUFFER, buffer.vb);
+    this.attribPointers(shader, shader.attribs, 0);
+    this.gl.bindBuffer(this.gl.ARRAY_BUFFER, instances.vb);
+    let locations = this.attribPointers(shader, shader.instanceAttribs, 1);
+
+    this.gl.bindBuffer(this.gl.ELEMENT_ARRAY_BUFFER, buffer.ib);
+    this.gl_ex_instanced.drawElementsInstancedANGLE(this.gl.TRIANGLES, buffer.indexCount, this.gl.UNSIGNED_SHORT, 0, instances.count);
+
+    // other shaders share attrib locations, leave them advancing per vertex
+    for (let location of locations) {
+      this.gl_ex_instanced.vertexAttribDivisorANGLE(location, 0);
+      this.gl.disableVertexAttribArray(location);
+    }
+  }
+
+  // the same picture as drawInstanced, one draw per instance with its attribs set as constants
+  drawInstancedFallback(shader, buffer, instances) {
+    let gl = this.gl;
+    gl.useProgram(shader.program);
+    gl.bindBuffer(gl.ARRAY_BUFFER, buffer.vb);
+    this.attribPointers(shader, shader.attribs, 0);
+    gl.bindBuffer(gl.ELEMENT_ARRAY_BUFFER, buffer.ib);
+
+    let attribs = [];
+    let instanceSize = 0;
+    for (let attrib of shader.instanceAttribs) {
+      let location = gl.getAttribLocation(shader.program, attrib.name);
+      if (location >= 0) {
+        gl.disableVertexAttribArray(location);
+        attribs.push({location: location, size: attrib.size, offset: instanceSize});
+      }
+      instanceSize += attrib.size;
+    }
+
+    let setters = [null, gl.vertexAttrib1fv, gl.vertexAttrib2fv, gl.vertexAttrib3fv, gl.vertexAttrib4fv];
+    for (let i = 0; i < instances.count; ++i) {
+      let at = i * instanceSize;
+      for (let attrib of attribs) {
+        setters[attrib.size].call(gl, attrib.location, instances.data.subarray(at + attrib.offset, at + attrib.offset + attrib.size));
+      }
+      gl.drawElements(gl.TRIANGLES, buffer.indexCount, gl.UNSIGNED_SHORT, 0);
+    }
+  }
 }